@@ -0,0 +1,79 @@
+#ifndef allocationCounter_h
+#define allocationCounter_h
+
+#include <atomic>
+#include <cstdint>
+#include <cstdlib>
+#include <new>
+
+//  Counts calls to the global operator new so the frame loop can prove it
+//  does not touch the heap once it has warmed up
+//  The replacement operators are only compiled in when COUNT_HEAP_ALLOCATIONS
+//  is defined, and since they replace the global ones this header must only
+//  be included from a single translation unit (main.cpp)
+//  Allocations made by C libraries through malloc directly (GLFW, the Vulkan
+//  loader and driver) are not seen here
+namespace allocationCounter {
+
+    inline std::atomic<uint64_t> allocations{0};
+
+    inline bool enabled() {
+#ifdef COUNT_HEAP_ALLOCATIONS
+        return true;
+#else
+        return false;
+#endif
+    }
+
+    //  Total number of operator new calls since startup
+    inline uint64_t count() {
+        return allocations.load(std::memory_order_relaxed);
+    }
+
+}
+
+#ifdef COUNT_HEAP_ALLOCATIONS
+
+void* operator new(std::size_t size) {
+    allocationCounter::allocations.fetch_add(1, std::memory_order_relaxed);
+
+    if (void* memory = std::malloc(size == 0 ? 1 : size)) {
+        return memory;
+    }
+
+    throw std::bad_alloc();
+}
+
+void* operator new(std::size_t size, std::align_val_t alignment) {
+    allocationCounter::allocations.fetch_add(1, std::memory_order_relaxed);
+
+    //  aligned_alloc requires the size to be a multiple of the alignment
+    std::size_t align = static_cast<std::size_t>(alignment);
+    std::size_t alignedSize = ((size == 0 ? 1 : size) + align - 1) & ~(align - 1);
+
+    if (void* memory = std::aligned_alloc(align, alignedSize)) {
+        return memory;
+    }
+
+    throw std::bad_alloc();
+}
+
+void operator delete(void* memory) noexcept {
+    std::free(memory);
+}
+
+void operator delete(void* memory, std::align_val_t) noexcept {
+    std::free(memory);
+}
+
+void operator delete(void* memory, std::size_t) noexcept {
+    std::free(memory);
+}
+
+void operator delete(void* memory, std::size_t, std::align_val_t) noexcept {
+    std::free(memory);
+}
+
+#endif
+
+#endif /* allocationCounter_h */
@@ -0,0 +1,72 @@
+#ifndef bufferHandler_h
+#define bufferHandler_h
+
+#include "dispatchTable.h"
+#include <stdexcept> // To report and propagate errors
+
+class BufferHandler {
+
+    //  Buffers in Vulkan do not allocate memory for themselves
+    //  The memory has to be allocated separately from a memory type
+    //  the device exposes and then bound to the buffer
+
+public:
+
+    //  Graphics cards offer different types of memory, each with its own
+    //  allowed operations and performance characteristics
+    //  Find a type that is allowed for the resource (`typeFilter`) and has all the requested properties
+    uint32_t findMemoryType(VkPhysicalDevice physicalDevice, uint32_t typeFilter, VkMemoryPropertyFlags properties) {
+
+        VkPhysicalDeviceMemoryProperties memProperties;
+        vkd.vkGetPhysicalDeviceMemoryProperties(physicalDevice, &memProperties);
+
+        for (uint32_t i = 0; i < memProperties.memoryTypeCount; i++) {
+            if ((typeFilter & (1 << i)) && (memProperties.memoryTypes[i].propertyFlags & properties) == properties) {
+                return i;
+            }
+        }
+
+        throw std::runtime_error("Failed to find suitable memory type!");
+    }
+
+    //  Creates a buffer and binds a fresh allocation of the requested memory properties to it
+    void createBuffer(VkPhysicalDevice physicalDevice, VkDevice device, VkDeviceSize size, VkBufferUsageFlags usage, VkMemoryPropertyFlags properties, VkBuffer& buffer, VkDeviceMemory& bufferMemory) {
+
+        VkBufferCreateInfo bufferInfo{};
+        bufferInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+        bufferInfo.size = size;
+        bufferInfo.usage = usage;
+        bufferInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+
+        if (vkd.vkCreateBuffer(device, &bufferInfo, nullptr, &buffer) != VK_SUCCESS) {
+            throw std::runtime_error("Failed to create buffer!");
+        }
+
+        VkMemoryRequirements memRequirements;
+        vkd.vkGetBufferMemoryRequirements(device, buffer, &memRequirements);
+
+        VkMemoryAllocateInfo allocInfo{};
+        allocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+        allocInfo.allocationSize = memRequirements.size;
+        allocInfo.memoryTypeIndex = findMemoryType(physicalDevice, memRequirements.memoryTypeBits, properties);
+
+        if (vkd.vkAllocateMemory(device, &allocInfo, nullptr, &bufferMemory) != VK_SUCCESS) {
+            throw std::runtime_error("Failed to allocate buffer memory!");
+        }
+
+        if (vkd.vkBindBufferMemory(device, buffer, bufferMemory, 0) != VK_SUCCESS) {
+            throw std::runtime_error("Failed to bind buffer memory!");
+        }
+    }
+
+    void destroyBuffer(VkDevice device, VkBuffer& buffer, VkDeviceMemory& bufferMemory) {
+        vkd.vkDestroyBuffer(device, buffer, nullptr);
+        vkd.vkFreeMemory(device, bufferMemory, nullptr);
+
+        buffer = VK_NULL_HANDLE;
+        bufferMemory = VK_NULL_HANDLE;
+    }
+
+};
+
+#endif /* bufferHandler_h */
@@ -0,0 +1,321 @@
+#ifndef compressedTextureHandler_h
+#define compressedTextureHandler_h
+
+#include "textureStreamingHandler.h"
+#include <fstream>
+#include <memory>
+#include <string>
+
+//  Basis Universal is an optional dependency
+//  Without it, only KTX2 files that already hold a block compressed format
+//  the device can sample are accepted
+#ifdef USE_BASISU_TRANSCODER
+#include "basisu_transcoder.h"
+#endif
+
+class CompressedTextureHandler {
+
+    //  Textures are shipped as KTX2 files
+    //  Supercompressed files (Basis Universal ETC1S or UASTC) are transcoded,
+    //  mip level by mip level, to the best block compressed format the
+    //  selected device can sample
+    //  Block compression keeps textures 4-8x smaller both in VRAM and in the
+    //  staging uploads, transcoding runs on the texture streaming thread
+
+public:
+
+    //  KTX2 supercompression schemes
+    static constexpr uint32_t SUPERCOMPRESSION_NONE = 0;
+    static constexpr uint32_t SUPERCOMPRESSION_BASIS_LZ = 1;
+    static constexpr uint32_t SUPERCOMPRESSION_ZSTD = 2;
+
+    struct Ktx2Level {
+        uint64_t byteOffset;
+        uint64_t byteLength;
+        uint64_t uncompressedByteLength;
+    };
+
+    struct Ktx2File {
+        std::string path;
+        VkFormat vkFormat;
+        uint32_t width;
+        uint32_t height;
+        uint32_t levelCount;
+        uint32_t supercompressionScheme;
+        bool srgb;
+
+        //  Level 0 is the largest
+        std::vector<Ktx2Level> levels;
+
+        //  Shared with the streaming sources, which read from it on the streaming thread
+        std::shared_ptr<const std::vector<uint8_t>> data;
+
+        //  Basis Universal payloads leave the format undefined, it is picked at transcode time
+        bool needsTranscoding() const {
+            return vkFormat == VK_FORMAT_UNDEFINED;
+        }
+    };
+
+    //  Records which block compressed formats can be sampled on the device
+    //  `enabledFeatures` is what the logical device was created with, a
+    //  supported format is useless if its feature was not enabled
+    void queryFormatSupport(VkPhysicalDevice physicalDevice, const VkPhysicalDeviceFeatures& enabledFeatures) {
+
+        this->physicalDevice = physicalDevice;
+
+        supportsBC = enabledFeatures.textureCompressionBC == VK_TRUE;
+        supportsASTC = enabledFeatures.textureCompressionASTC_LDR == VK_TRUE;
+        supportsETC2 = enabledFeatures.textureCompressionETC2 == VK_TRUE;
+
+        std::cout << "Texture compression support BC: " << supportsBC << " ASTC: " << supportsASTC << " ETC2: " << supportsETC2 << std::endl;
+    }
+
+    //  Best sampleable format for the file
+    //  Preference is by quality per bit: BC7 and ASTC 4x4 first, ETC2, then
+    //  BC3, and uncompressed RGBA8 as the last resort
+    VkFormat chooseTargetFormat(const Ktx2File& file) {
+
+        if (!file.needsTranscoding()) {
+
+            //  The streamer sizes levels from the format's block size
+            if (!TextureStreamingHandler::isKnownFormat(file.vkFormat)) {
+                throw std::runtime_error("Texture format in " + file.path + " is not supported by the streamer!");
+            }
+
+            if (!isSampleable(file.vkFormat)) {
+                throw std::runtime_error("Texture format in " + file.path + " is not supported by the device!");
+            }
+
+            return file.vkFormat;
+        }
+
+        const bool srgb = file.srgb;
+
+        const VkFormat candidates[] = {
+            supportsBC ? (srgb ? VK_FORMAT_BC7_SRGB_BLOCK : VK_FORMAT_BC7_UNORM_BLOCK) : VK_FORMAT_UNDEFINED,
+            supportsASTC ? (srgb ? VK_FORMAT_ASTC_4x4_SRGB_BLOCK : VK_FORMAT_ASTC_4x4_UNORM_BLOCK) : VK_FORMAT_UNDEFINED,
+            supportsETC2 ? (srgb ? VK_FORMAT_ETC2_R8G8B8A8_SRGB_BLOCK : VK_FORMAT_ETC2_R8G8B8A8_UNORM_BLOCK) : VK_FORMAT_UNDEFINED,
+            supportsBC ? (srgb ? VK_FORMAT_BC3_SRGB_BLOCK : VK_FORMAT_BC3_UNORM_BLOCK) : VK_FORMAT_UNDEFINED,
+        };
+
+        for (VkFormat format : candidates) {
+            if (format != VK_FORMAT_UNDEFINED && isSampleable(format)) {
+                return format;
+            }
+        }
+
+        return srgb ? VK_FORMAT_R8G8B8A8_SRGB : VK_FORMAT_R8G8B8A8_UNORM;
+    }
+
+    //  Reads and validates a KTX2 file
+    //  Only 2D textures with a single layer and face are supported
+    Ktx2File loadKtx2(const std::string& path) {
+
+        std::ifstream stream(path, std::ios::binary | std::ios::ate);
+
+        if (!stream) {
+            throw std::runtime_error("Failed to open texture " + path);
+        }
+
+        auto data = std::make_shared<std::vector<uint8_t>>(static_cast<size_t>(stream.tellg()));
+        stream.seekg(0);
+        stream.read(reinterpret_cast<char*>(data->data()), data->size());
+
+        static const uint8_t identifier[12] = { 0xAB, 'K', 'T', 'X', ' ', '2', '0', 0xBB, '\r', '\n', 0x1A, '\n' };
+
+        //  identifier, 9 header words, 4 index words and 2 64-bit index entries
+        const size_t headerSize = 12 + 9 * 4 + 4 * 4 + 2 * 8;
+
+        if (data->size() < headerSize || memcmp(data->data(), identifier, sizeof(identifier)) != 0) {
+            throw std::runtime_error(path + " is not a KTX2 file!");
+        }
+
+        const uint8_t* bytes = data->data();
+
+        Ktx2File file;
+        file.path = path;
+        file.vkFormat = static_cast<VkFormat>(read32(bytes, 12));
+        file.width = read32(bytes, 20);
+        file.height = read32(bytes, 24);
+        file.levelCount = std::max(1u, read32(bytes, 40));
+        file.supercompressionScheme = read32(bytes, 44);
+
+        uint32_t depth = read32(bytes, 28);
+        uint32_t layerCount = read32(bytes, 32);
+        uint32_t faceCount = read32(bytes, 36);
+
+        if (file.width == 0 || file.height == 0 || depth > 1 || layerCount > 1 || faceCount != 1) {
+            throw std::runtime_error(path + " is not a plain 2D texture!");
+        }
+
+        if (file.levelCount > TextureStreamingHandler::fullMipChainLength(file.width, file.height)) {
+            throw std::runtime_error(path + " has more levels than its size allows!");
+        }
+
+        //  Zstandard is only understood as part of a UASTC payload, which the transcoder unpacks
+        bool basisScheme = file.supercompressionScheme == SUPERCOMPRESSION_BASIS_LZ || file.supercompressionScheme == SUPERCOMPRESSION_ZSTD;
+
+        if (file.needsTranscoding() ? !(basisScheme || file.supercompressionScheme == SUPERCOMPRESSION_NONE) : file.supercompressionScheme != SUPERCOMPRESSION_NONE) {
+            throw std::runtime_error(path + " uses an unsupported supercompression scheme!");
+        }
+
+        if (!file.needsTranscoding() && !TextureStreamingHandler::isKnownFormat(file.vkFormat)) {
+            throw std::runtime_error(path + " uses a format the streamer does not support!");
+        }
+
+        //  Offsets and lengths come from the file, every check subtracts from
+        //  the file size so none of them can wrap around
+        const uint64_t size = data->size();
+
+        //  The transfer function is in the third word of the basic data format descriptor block
+        uint64_t dfdOffset = read32(bytes, 48);
+
+        if (dfdOffset > size || size - dfdOffset < 16) {
+            throw std::runtime_error(path + " has a truncated data format descriptor!");
+        }
+
+        const uint32_t KHR_DF_TRANSFER_SRGB = 2;
+        file.srgb = ((read32(bytes, dfdOffset + 12) >> 16) & 0xFF) == KHR_DF_TRANSFER_SRGB;
+
+        const size_t levelIndexOffset = headerSize;
+
+        if (uint64_t(file.levelCount) * 24 > size - levelIndexOffset) {
+            throw std::runtime_error(path + " has a truncated level index!");
+        }
+
+        for (uint32_t level = 0; level < file.levelCount; level++) {
+            Ktx2Level entry;
+            entry.byteOffset = read64(bytes, levelIndexOffset + level * 24);
+            entry.byteLength = read64(bytes, levelIndexOffset + level * 24 + 8);
+            entry.uncompressedByteLength = read64(bytes, levelIndexOffset + level * 24 + 16);
+
+            if (entry.byteOffset > size || entry.byteLength > size - entry.byteOffset) {
+                throw std::runtime_error(path + " has a level outside of the file!");
+            }
+
+            //  Levels that are not supercompressed are copied straight into the staging buffer
+            if (!file.needsTranscoding() && entry.byteLength != TextureStreamingHandler::mipByteSize(file.vkFormat, std::max(1u, file.width >> level), std::max(1u, file.height >> level))) {
+                throw std::runtime_error(path + " has a level of the wrong size!");
+            }
+
+            file.levels.push_back(entry);
+        }
+
+        file.data = std::move(data);
+
+        return file;
+    }
+
+    //  Wraps a KTX2 file as a texture streaming source
+    //  Each level is transcoded on demand, on the streaming thread
+    TextureStreamingHandler::TextureSource makeStreamingSource(const Ktx2File& file, VkFormat targetFormat) {
+
+        TextureStreamingHandler::TextureSource source;
+        source.width = file.width;
+        source.height = file.height;
+        source.mipLevels = file.levelCount;
+        source.format = targetFormat;
+
+        if (!file.needsTranscoding()) {
+            source.loadMip = [file](uint32_t mipLevel) {
+                const Ktx2Level& level = file.levels[mipLevel];
+                const uint8_t* begin = file.data->data() + level.byteOffset;
+                return std::vector<uint8_t>(begin, begin + level.byteLength);
+            };
+
+            return source;
+        }
+
+#ifdef USE_BASISU_TRANSCODER
+        static std::once_flag transcoderInit;
+        std::call_once(transcoderInit, [] { basist::basisu_transcoder_init(); });
+
+        basist::transcoder_texture_format transcodeFormat = toBasisFormat(targetFormat);
+
+        //  ktx2_transcoder is not thread safe, every source owns one and it is only used on the streaming thread
+        auto transcoder = std::make_shared<basist::ktx2_transcoder>();
+
+        if (!transcoder->init(file.data->data(), static_cast<uint32_t>(file.data->size())) || !transcoder->start_transcoding()) {
+            throw std::runtime_error("Failed to start transcoding " + file.path);
+        }
+
+        source.loadMip = [file, transcoder, transcodeFormat, targetFormat](uint32_t mipLevel) {
+
+            uint32_t width = std::max(1u, file.width >> mipLevel);
+            uint32_t height = std::max(1u, file.height >> mipLevel);
+
+            std::vector<uint8_t> blocks(TextureStreamingHandler::mipByteSize(targetFormat, width, height));
+
+            //  For block formats the output size is given in blocks, for RGBA32 in pixels
+            uint32_t outputUnits = basist::basis_transcoder_format_is_uncompressed(transcodeFormat)
+                ? width * height
+                : static_cast<uint32_t>(blocks.size() / basist::basis_get_bytes_per_block_or_pixel(transcodeFormat));
+
+            if (!transcoder->transcode_image_level(mipLevel, 0, 0, blocks.data(), outputUnits, transcodeFormat)) {
+                throw std::runtime_error("Failed to transcode level " + std::to_string(mipLevel) + " of " + file.path);
+            }
+
+            return blocks;
+        };
+
+        return source;
+#else
+        (void)targetFormat;
+        throw std::runtime_error(file.path + " needs Basis Universal transcoding, build with USE_BASISU_TRANSCODER");
+#endif
+    }
+
+private:
+
+    VkPhysicalDevice physicalDevice = VK_NULL_HANDLE;
+    bool supportsBC = false;
+    bool supportsASTC = false;
+    bool supportsETC2 = false;
+
+    //  A format may be part of an enabled family and still not be sampleable with optimal tiling
+    bool isSampleable(VkFormat format) {
+
+        VkFormatProperties properties;
+        vkd.vkGetPhysicalDeviceFormatProperties(physicalDevice, format, &properties);
+
+        return (properties.optimalTilingFeatures & VK_FORMAT_FEATURE_SAMPLED_IMAGE_BIT) != 0;
+    }
+
+    //  KTX2 is little endian, as are all the platforms this runs on
+    static uint32_t read32(const uint8_t* bytes, size_t offset) {
+        uint32_t value;
+        memcpy(&value, bytes + offset, sizeof(value));
+        return value;
+    }
+
+    static uint64_t read64(const uint8_t* bytes, size_t offset) {
+        uint64_t value;
+        memcpy(&value, bytes + offset, sizeof(value));
+        return value;
+    }
+
+#ifdef USE_BASISU_TRANSCODER
+    static basist::transcoder_texture_format toBasisFormat(VkFormat format) {
+
+        switch (format) {
+            case VK_FORMAT_BC7_UNORM_BLOCK:
+            case VK_FORMAT_BC7_SRGB_BLOCK:
+                return basist::transcoder_texture_format::cTFBC7_RGBA;
+            case VK_FORMAT_ASTC_4x4_UNORM_BLOCK:
+            case VK_FORMAT_ASTC_4x4_SRGB_BLOCK:
+                return basist::transcoder_texture_format::cTFASTC_4x4_RGBA;
+            case VK_FORMAT_ETC2_R8G8B8A8_UNORM_BLOCK:
+            case VK_FORMAT_ETC2_R8G8B8A8_SRGB_BLOCK:
+                return basist::transcoder_texture_format::cTFETC2_RGBA;
+            case VK_FORMAT_BC3_UNORM_BLOCK:
+            case VK_FORMAT_BC3_SRGB_BLOCK:
+                return basist::transcoder_texture_format::cTFBC3_RGBA;
+            default:
+                return basist::transcoder_texture_format::cTFRGBA32;
+        }
+    }
+#endif
+
+};
+
+#endif /* compressedTextureHandler_h */
@@ -0,0 +1,292 @@
+#ifndef dispatchTable_h
+#define dispatchTable_h
+
+//  The build defines VK_NO_PROTOTYPES, so the Vulkan header declares none of
+//  the loader's exported functions
+#ifndef VK_NO_PROTOTYPES
+#error "VK_NO_PROTOTYPES has to be defined for every file that uses the dispatch table"
+#endif
+
+#define GLFW_INCLUDE_VULKAN
+#include <GLFW/glfw3.h>
+#include "frameStats.h"
+#include <stdexcept> // To report and propagate errors
+#include <string>
+
+//  The one loader export called directly, every other function is looked up through it
+extern "C" VKAPI_ATTR PFN_vkVoidFunction VKAPI_CALL vkGetInstanceProcAddr(VkInstance instance, const char* pName);
+
+//  Every Vulkan function exported by the loader is a trampoline: it looks up
+//  the dispatch table of the instance or device the first argument belongs to
+//  and jumps to the driver from there
+//  Loading the functions ourselves skips that hop
+//  Device functions come from `vkGetDeviceProcAddr`, which returns the
+//  driver's (or the first layer's) entry point directly
+//  Instance functions come from `vkGetInstanceProcAddr`, they are still
+//  dispatched by the loader but are not on any hot path
+//
+//  Calls go through the global `vkd` table, `vkd.vkCmdDraw(...)` instead of `vkCmdDraw(...)`
+//  The only exported symbol called directly is `vkGetInstanceProcAddr`
+//
+//  A function used anywhere has to be listed below, with VK_NO_PROTOTYPES
+//  an unlisted one is a compile error rather than a silent trampoline call
+//
+//  The functions that create or destroy objects or allocate memory are
+//  wrapped once loaded, the wrapper updates `frameStats` and calls the
+//  driver's entry point
+//  Hot commands such as submits and draws are never wrapped, they always
+//  call straight into the driver
+
+//  Callable before an instance exists
+#define DISPATCH_GLOBAL_FUNCTIONS(X) \
+    X(vkCreateInstance) \
+    X(vkEnumerateInstanceExtensionProperties) \
+    X(vkEnumerateInstanceLayerProperties)
+
+#define DISPATCH_INSTANCE_FUNCTIONS(X) \
+    X(vkDestroyInstance) \
+    X(vkEnumeratePhysicalDevices) \
+    X(vkGetPhysicalDeviceProperties) \
+    X(vkGetPhysicalDeviceFeatures) \
+    X(vkGetPhysicalDeviceFormatProperties) \
+    X(vkGetPhysicalDeviceMemoryProperties) \
+    X(vkGetPhysicalDeviceQueueFamilyProperties) \
+    X(vkEnumerateDeviceExtensionProperties) \
+    X(vkCreateDevice) \
+    X(vkGetDeviceProcAddr)
+
+//  Extension functions are left null when their extension is not enabled,
+//  as in headless runs that never create a surface
+#define DISPATCH_INSTANCE_EXTENSION_FUNCTIONS(X) \
+    X(vkGetPhysicalDeviceSurfaceSupportKHR) \
+    X(vkGetPhysicalDeviceSurfaceCapabilitiesKHR) \
+    X(vkGetPhysicalDeviceSurfaceFormatsKHR) \
+    X(vkGetPhysicalDeviceSurfacePresentModesKHR) \
+    X(vkDestroySurfaceKHR) \
+    X(vkGetPhysicalDeviceMemoryProperties2KHR)
+
+#define DISPATCH_DEVICE_FUNCTIONS(X) \
+    X(vkDestroyDevice) \
+    X(vkDeviceWaitIdle) \
+    X(vkGetDeviceQueue) \
+    X(vkQueueSubmit) \
+    X(vkCreateSemaphore) \
+    X(vkDestroySemaphore) \
+    X(vkCreateFence) \
+    X(vkDestroyFence) \
+    X(vkWaitForFences) \
+    X(vkResetFences) \
+    X(vkCreateBuffer) \
+    X(vkDestroyBuffer) \
+    X(vkGetBufferMemoryRequirements) \
+    X(vkBindBufferMemory) \
+    X(vkCreateImage) \
+    X(vkDestroyImage) \
+    X(vkGetImageMemoryRequirements) \
+    X(vkBindImageMemory) \
+    X(vkCreateImageView) \
+    X(vkDestroyImageView) \
+    X(vkAllocateMemory) \
+    X(vkFreeMemory) \
+    X(vkMapMemory) \
+    X(vkUnmapMemory) \
+    X(vkCreateCommandPool) \
+    X(vkDestroyCommandPool) \
+    X(vkResetCommandPool) \
+    X(vkAllocateCommandBuffers) \
+    X(vkBeginCommandBuffer) \
+    X(vkEndCommandBuffer) \
+    X(vkCreateDescriptorPool) \
+    X(vkDestroyDescriptorPool) \
+    X(vkResetDescriptorPool) \
+    X(vkAllocateDescriptorSets) \
+    X(vkCreateShaderModule) \
+    X(vkDestroyShaderModule) \
+    X(vkCreatePipelineLayout) \
+    X(vkDestroyPipelineLayout) \
+    X(vkCreateGraphicsPipelines) \
+    X(vkDestroyPipeline) \
+    X(vkCreateRenderPass) \
+    X(vkDestroyRenderPass) \
+    X(vkCreateFramebuffer) \
+    X(vkDestroyFramebuffer) \
+    X(vkCmdBeginRenderPass) \
+    X(vkCmdEndRenderPass) \
+    X(vkCmdBindPipeline) \
+    X(vkCmdDraw) \
+    X(vkCmdClearColorImage) \
+    X(vkCmdPipelineBarrier) \
+    X(vkCmdCopyBuffer) \
+    X(vkCmdCopyImage) \
+    X(vkCmdCopyBufferToImage)
+
+#define DISPATCH_DEVICE_EXTENSION_FUNCTIONS(X) \
+    X(vkCreateSwapchainKHR) \
+    X(vkDestroySwapchainKHR) \
+    X(vkGetSwapchainImagesKHR) \
+    X(vkAcquireNextImageKHR) \
+    X(vkQueuePresentKHR)
+
+//  Objects created and destroyed with the usual
+//  `vkCreateX(device, pCreateInfo, pAllocator, pObject)` and `vkDestroyX(device, object, pAllocator)`
+//  Memory and pipelines have their own wrappers below
+#define DISPATCH_COUNTED_OBJECTS(X) \
+    X(Buffer, VkBuffer, VkBufferCreateInfo, vkCreateBuffer, vkDestroyBuffer) \
+    X(Image, VkImage, VkImageCreateInfo, vkCreateImage, vkDestroyImage) \
+    X(ImageView, VkImageView, VkImageViewCreateInfo, vkCreateImageView, vkDestroyImageView) \
+    X(Semaphore, VkSemaphore, VkSemaphoreCreateInfo, vkCreateSemaphore, vkDestroySemaphore) \
+    X(Fence, VkFence, VkFenceCreateInfo, vkCreateFence, vkDestroyFence) \
+    X(CommandPool, VkCommandPool, VkCommandPoolCreateInfo, vkCreateCommandPool, vkDestroyCommandPool) \
+    X(DescriptorPool, VkDescriptorPool, VkDescriptorPoolCreateInfo, vkCreateDescriptorPool, vkDestroyDescriptorPool) \
+    X(ShaderModule, VkShaderModule, VkShaderModuleCreateInfo, vkCreateShaderModule, vkDestroyShaderModule) \
+    X(PipelineLayout, VkPipelineLayout, VkPipelineLayoutCreateInfo, vkCreatePipelineLayout, vkDestroyPipelineLayout) \
+    X(RenderPass, VkRenderPass, VkRenderPassCreateInfo, vkCreateRenderPass, vkDestroyRenderPass) \
+    X(Framebuffer, VkFramebuffer, VkFramebufferCreateInfo, vkCreateFramebuffer, vkDestroyFramebuffer) \
+    X(Swapchain, VkSwapchainKHR, VkSwapchainCreateInfoKHR, vkCreateSwapchainKHR, vkDestroySwapchainKHR)
+
+#define DISPATCH_COUNTED_FUNCTIONS(X) \
+    X(vkAllocateMemory) \
+    X(vkFreeMemory) \
+    X(vkCreateGraphicsPipelines) \
+    X(vkDestroyPipeline)
+
+class DispatchTable {
+
+public:
+
+#define DISPATCH_MEMBER(name) PFN_##name name = nullptr;
+    DISPATCH_GLOBAL_FUNCTIONS(DISPATCH_MEMBER)
+    DISPATCH_INSTANCE_FUNCTIONS(DISPATCH_MEMBER)
+    DISPATCH_INSTANCE_EXTENSION_FUNCTIONS(DISPATCH_MEMBER)
+    DISPATCH_DEVICE_FUNCTIONS(DISPATCH_MEMBER)
+    DISPATCH_DEVICE_EXTENSION_FUNCTIONS(DISPATCH_MEMBER)
+#undef DISPATCH_MEMBER
+
+    //  Before `vkCreateInstance`
+    void loadGlobal() {
+#define DISPATCH_LOAD(name) name = reinterpret_cast<PFN_##name>(load(vkGetInstanceProcAddr(VK_NULL_HANDLE, #name), #name));
+        DISPATCH_GLOBAL_FUNCTIONS(DISPATCH_LOAD)
+#undef DISPATCH_LOAD
+    }
+
+    //  After `vkCreateInstance`
+    void loadInstance(VkInstance instance) {
+#define DISPATCH_LOAD(name) name = reinterpret_cast<PFN_##name>(load(vkGetInstanceProcAddr(instance, #name), #name));
+        DISPATCH_INSTANCE_FUNCTIONS(DISPATCH_LOAD)
+#undef DISPATCH_LOAD
+#define DISPATCH_LOAD(name) name = reinterpret_cast<PFN_##name>(vkGetInstanceProcAddr(instance, #name));
+        DISPATCH_INSTANCE_EXTENSION_FUNCTIONS(DISPATCH_LOAD)
+#undef DISPATCH_LOAD
+    }
+
+    //  After `vkCreateDevice`, again whenever the device is recreated
+    //  The pointers are only valid for `device`, a single device is assumed
+    void loadDevice(VkDevice device) {
+#define DISPATCH_LOAD(name) name = reinterpret_cast<PFN_##name>(load(vkGetDeviceProcAddr(device, #name), #name));
+        DISPATCH_DEVICE_FUNCTIONS(DISPATCH_LOAD)
+#undef DISPATCH_LOAD
+#define DISPATCH_LOAD(name) name = reinterpret_cast<PFN_##name>(vkGetDeviceProcAddr(device, #name));
+        DISPATCH_DEVICE_EXTENSION_FUNCTIONS(DISPATCH_LOAD)
+#undef DISPATCH_LOAD
+        
+        //  The wrappers take the place of the driver's entry points,
+        //  extension functions that were not loaded stay null
+#define DISPATCH_WRAP(name) if (name != nullptr) { driver.name = name; name = counted_##name; }
+#define DISPATCH_WRAP_OBJECT(type, handle, createInfo, create, destroy) DISPATCH_WRAP(create) DISPATCH_WRAP(destroy)
+        DISPATCH_COUNTED_OBJECTS(DISPATCH_WRAP_OBJECT)
+        DISPATCH_COUNTED_FUNCTIONS(DISPATCH_WRAP)
+#undef DISPATCH_WRAP_OBJECT
+#undef DISPATCH_WRAP
+    }
+
+private:
+
+    //  The driver's entry points behind the wrappers
+    //  Static, so the wrappers can reach them with the same signature as the
+    //  function they replace, and zero initialized like any static
+    struct DriverFunctions {
+#define DISPATCH_MEMBER(name) PFN_##name name;
+#define DISPATCH_OBJECT_MEMBERS(type, handle, createInfo, create, destroy) DISPATCH_MEMBER(create) DISPATCH_MEMBER(destroy)
+        DISPATCH_COUNTED_OBJECTS(DISPATCH_OBJECT_MEMBERS)
+        DISPATCH_COUNTED_FUNCTIONS(DISPATCH_MEMBER)
+#undef DISPATCH_OBJECT_MEMBERS
+#undef DISPATCH_MEMBER
+    };
+
+    static inline DriverFunctions driver;
+
+#define DISPATCH_COUNTED_OBJECT(type, handle, createInfo, create, destroy) \
+    static VkResult VKAPI_CALL counted_##create(VkDevice device, const createInfo* pCreateInfo, const VkAllocationCallbacks* pAllocator, handle* pObject) { \
+        VkResult result = driver.create(device, pCreateInfo, pAllocator, pObject); \
+        if (result == VK_SUCCESS) { \
+            frameStats::objectCreated(frameStats::ObjectType::type); \
+        } \
+        return result; \
+    } \
+    static void VKAPI_CALL counted_##destroy(VkDevice device, handle object, const VkAllocationCallbacks* pAllocator) { \
+        if (object != VK_NULL_HANDLE) { \
+            frameStats::objectDestroyed(frameStats::ObjectType::type); \
+        } \
+        driver.destroy(device, object, pAllocator); \
+    }
+    DISPATCH_COUNTED_OBJECTS(DISPATCH_COUNTED_OBJECT)
+#undef DISPATCH_COUNTED_OBJECT
+
+    static VkResult VKAPI_CALL counted_vkAllocateMemory(VkDevice device, const VkMemoryAllocateInfo* pAllocateInfo, const VkAllocationCallbacks* pAllocator, VkDeviceMemory* pMemory) {
+
+        VkResult result = driver.vkAllocateMemory(device, pAllocateInfo, pAllocator, pMemory);
+
+        if (result == VK_SUCCESS) {
+            frameStats::memoryAllocated(*pMemory, pAllocateInfo->memoryTypeIndex, pAllocateInfo->allocationSize);
+        }
+
+        return result;
+    }
+
+    static void VKAPI_CALL counted_vkFreeMemory(VkDevice device, VkDeviceMemory memory, const VkAllocationCallbacks* pAllocator) {
+
+        if (memory != VK_NULL_HANDLE) {
+            frameStats::memoryFreed(memory);
+        }
+
+        driver.vkFreeMemory(device, memory, pAllocator);
+    }
+
+    //  A failed call may still have created some of the pipelines, the ones that were not are VK_NULL_HANDLE
+    static VkResult VKAPI_CALL counted_vkCreateGraphicsPipelines(VkDevice device, VkPipelineCache pipelineCache, uint32_t createInfoCount, const VkGraphicsPipelineCreateInfo* pCreateInfos, const VkAllocationCallbacks* pAllocator, VkPipeline* pPipelines) {
+
+        VkResult result = driver.vkCreateGraphicsPipelines(device, pipelineCache, createInfoCount, pCreateInfos, pAllocator, pPipelines);
+
+        for (uint32_t i = 0; i < createInfoCount; i++) {
+            if (pPipelines[i] != VK_NULL_HANDLE) {
+                frameStats::objectCreated(frameStats::ObjectType::Pipeline);
+            }
+        }
+
+        return result;
+    }
+
+    static void VKAPI_CALL counted_vkDestroyPipeline(VkDevice device, VkPipeline pipeline, const VkAllocationCallbacks* pAllocator) {
+
+        if (pipeline != VK_NULL_HANDLE) {
+            frameStats::objectDestroyed(frameStats::ObjectType::Pipeline);
+        }
+
+        driver.vkDestroyPipeline(device, pipeline, pAllocator);
+    }
+
+    static PFN_vkVoidFunction load(PFN_vkVoidFunction function, const char* name) {
+
+        if (function == nullptr) {
+            throw std::runtime_error(std::string("Failed to load Vulkan function ") + name + "!");
+        }
+
+        return function;
+    }
+
+};
+
+//  The table every handler calls through
+inline DispatchTable vkd;
+
+#endif /* dispatchTable_h */
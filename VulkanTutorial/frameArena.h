@@ -0,0 +1,155 @@
+#ifndef frameArena_h
+#define frameArena_h
+
+#include <memory_resource>
+#include <memory>
+#include <cstddef>
+#include <cstdint>
+#include <new>
+
+class FrameArena : public std::pmr::memory_resource {
+
+    //  Bump allocator for data that only lives for one frame
+    //  Allocating is a pointer increment and freeing does nothing, everything
+    //  handed out is released at once by `reset` at the start of the next frame
+    //  Plug it into std::pmr containers:
+    //      std::pmr::vector<VkSemaphore> waitSemaphores(&frameArena);
+
+public:
+
+    static constexpr size_t DEFAULT_CAPACITY = 1024 * 1024;
+
+    //  Alignment of the buffer itself, a cache line, which also covers AVX
+    //  registers and `alignas(64)` data
+    //  Offsets are aligned relative to it, so no larger alignment can be honoured
+    static constexpr size_t BUFFER_ALIGNMENT = 64;
+
+    explicit FrameArena(size_t capacity = DEFAULT_CAPACITY)
+        : buffer(allocateBuffer(capacity)), capacity(capacity) {}
+
+    FrameArena(const FrameArena&) = delete;
+    FrameArena& operator=(const FrameArena&) = delete;
+
+    ~FrameArena() override {
+        releaseOverflow();
+    }
+
+    //  Releases everything allocated since the last reset
+    //  If the arena ran out during the frame, the buffer is regrown once here
+    //  so the following frames fit without touching the heap again
+    void reset() {
+
+        if (overflowBlocks != nullptr) {
+            releaseOverflow();
+
+            capacity = highWaterMark * 2;
+            buffer = allocateBuffer(capacity);
+        }
+
+        offset = 0;
+        overflowBytes = 0;
+    }
+
+    size_t bytesUsed() const { return offset + overflowBytes; }
+    size_t bytesReserved() const { return capacity; }
+
+    //  Largest amount allocated in a single frame so far
+    size_t peakBytes() const { return highWaterMark; }
+
+protected:
+
+    void* do_allocate(size_t bytes, size_t alignment) override {
+
+        if (alignment > BUFFER_ALIGNMENT) {
+            throw std::bad_alloc();
+        }
+
+        size_t alignedOffset = (offset + alignment - 1) & ~(alignment - 1);
+
+        if (alignedOffset + bytes <= capacity) {
+            offset = alignedOffset + bytes;
+            updateHighWaterMark();
+            return buffer.get() + alignedOffset;
+        }
+
+        return allocateOverflow(bytes, alignment);
+    }
+
+    //  Individual frees are ignored, memory comes back on `reset`
+    void do_deallocate(void*, size_t, size_t) override {}
+
+    bool do_is_equal(const std::pmr::memory_resource& other) const noexcept override {
+        return this == &other;
+    }
+
+private:
+
+    //  Blocks taken from the heap when the buffer is full
+    //  They are chained through a header at the start of each block
+    struct OverflowBlock {
+        OverflowBlock* next;
+        size_t size;
+        size_t alignment;
+    };
+
+    struct AlignedDelete {
+        void operator()(std::byte* memory) const {
+            ::operator delete(memory, std::align_val_t{BUFFER_ALIGNMENT});
+        }
+    };
+
+    using Buffer = std::unique_ptr<std::byte, AlignedDelete>;
+
+    static Buffer allocateBuffer(size_t capacity) {
+        return Buffer(static_cast<std::byte*>(::operator new(capacity, std::align_val_t{BUFFER_ALIGNMENT})));
+    }
+
+    Buffer buffer;
+    size_t capacity;
+    size_t offset = 0;
+
+    OverflowBlock* overflowBlocks = nullptr;
+    size_t overflowBytes = 0;
+    size_t highWaterMark = 0;
+
+    void updateHighWaterMark() {
+        if (bytesUsed() > highWaterMark) {
+            highWaterMark = bytesUsed();
+        }
+    }
+
+    void* allocateOverflow(size_t bytes, size_t alignment) {
+
+        if (alignment < alignof(OverflowBlock)) {
+            alignment = alignof(OverflowBlock);
+        }
+
+        size_t headerSize = (sizeof(OverflowBlock) + alignment - 1) & ~(alignment - 1);
+        size_t blockSize = headerSize + bytes;
+
+        void* memory = std::pmr::new_delete_resource()->allocate(blockSize, alignment);
+
+        OverflowBlock* block = static_cast<OverflowBlock*>(memory);
+        block->next = overflowBlocks;
+        block->size = blockSize;
+        block->alignment = alignment;
+        overflowBlocks = block;
+
+        overflowBytes += bytes;
+        updateHighWaterMark();
+
+        return static_cast<std::byte*>(memory) + headerSize;
+    }
+
+    void releaseOverflow() {
+
+        while (overflowBlocks != nullptr) {
+            OverflowBlock* next = overflowBlocks->next;
+            std::pmr::new_delete_resource()->deallocate(overflowBlocks, overflowBlocks->size, overflowBlocks->alignment);
+            overflowBlocks = next;
+        }
+    }
+
+};
+
+#endif /* frameArena_h */
@@ -0,0 +1,250 @@
+#ifndef frameResourcesHandler_h
+#define frameResourcesHandler_h
+
+#include "bufferHandler.h"
+#include "vulkanErrors.h"
+#include "frameStats.h"
+#include <vector>
+#include <array>
+
+class FrameResourcesHandler {
+
+    //  Every frame in flight owns its own command pool, descriptor pool and
+    //  slice of the uniform buffer
+    //  Nothing is freed individually, once the frame's fence has signalled the
+    //  GPU is done with all of it and the whole frame is reset in one go with
+    //  `vkResetCommandPool` and `vkResetDescriptorPool`
+    //  Command buffers are kept allocated across resets and handed out again,
+    //  so after the first few frames no Vulkan objects are created at all
+
+public:
+
+    static constexpr uint32_t MAX_FRAMES_IN_FLIGHT = 2;
+
+    //  Size of each frame's slice of the uniform buffer
+    static constexpr VkDeviceSize UNIFORM_ARENA_SIZE = 256 * 1024;
+
+    //  Capacity of each frame's descriptor pool
+    static constexpr uint32_t MAX_DESCRIPTOR_SETS = 256;
+
+    struct Frame {
+        VkCommandPool commandPool = VK_NULL_HANDLE;
+        VkDescriptorPool descriptorPool = VK_NULL_HANDLE;
+
+        //  Created signalled so the first wait on each frame returns immediately
+        VkFence fence = VK_NULL_HANDLE;
+
+        //  Every command buffer ever allocated from `commandPool`
+        //  `usedCommandBuffers` of them have been handed out this frame
+        std::vector<VkCommandBuffer> commandBuffers;
+        size_t usedCommandBuffers = 0;
+
+        //  Bump offset into this frame's slice of the uniform buffer
+        VkDeviceSize uniformOffset = 0;
+    };
+
+    //  Result of a uniform allocation
+    //  `data` is where the CPU writes, `dynamicOffset` is what is passed to
+    //  `vkCmdBindDescriptorSets` for a VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC binding
+    struct UniformAllocation {
+        void* data;
+        uint32_t dynamicOffset;
+    };
+
+    std::array<Frame, MAX_FRAMES_IN_FLIGHT> frames;
+    uint32_t currentFrame = 0;
+
+    //  One buffer backs the uniform data of every frame
+    //  It stays mapped for the lifetime of the handler
+    VkBuffer uniformBuffer = VK_NULL_HANDLE;
+    VkDeviceMemory uniformBufferMemory = VK_NULL_HANDLE;
+
+    void createFrameResources(VkPhysicalDevice physicalDevice, VkDevice device, uint32_t queueFamilyIndex) {
+
+        VkPhysicalDeviceProperties properties;
+        vkd.vkGetPhysicalDeviceProperties(physicalDevice, &properties);
+        uniformAlignment = properties.limits.minUniformBufferOffsetAlignment;
+
+        for (Frame& frame : frames) {
+
+            //  TRANSIENT tells the driver the command buffers are short lived,
+            //  individual resets are never used so RESET_COMMAND_BUFFER_BIT is left out
+            VkCommandPoolCreateInfo poolInfo{};
+            poolInfo.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+            poolInfo.flags = VK_COMMAND_POOL_CREATE_TRANSIENT_BIT;
+            poolInfo.queueFamilyIndex = queueFamilyIndex;
+
+            if (vkd.vkCreateCommandPool(device, &poolInfo, nullptr, &frame.commandPool) != VK_SUCCESS) {
+                throw std::runtime_error("Failed to create frame command pool!");
+            }
+
+            //  FREE_DESCRIPTOR_SET_BIT is left out as well, sets are only
+            //  released through `vkResetDescriptorPool`
+            std::array<VkDescriptorPoolSize, 2> poolSizes{};
+            poolSizes[0].type = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC;
+            poolSizes[0].descriptorCount = MAX_DESCRIPTOR_SETS;
+            poolSizes[1].type = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+            poolSizes[1].descriptorCount = MAX_DESCRIPTOR_SETS;
+
+            VkDescriptorPoolCreateInfo descriptorPoolInfo{};
+            descriptorPoolInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+            descriptorPoolInfo.maxSets = MAX_DESCRIPTOR_SETS;
+            descriptorPoolInfo.poolSizeCount = static_cast<uint32_t>(poolSizes.size());
+            descriptorPoolInfo.pPoolSizes = poolSizes.data();
+
+            if (vkd.vkCreateDescriptorPool(device, &descriptorPoolInfo, nullptr, &frame.descriptorPool) != VK_SUCCESS) {
+                throw std::runtime_error("Failed to create frame descriptor pool!");
+            }
+
+            VkFenceCreateInfo fenceInfo{};
+            fenceInfo.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
+            fenceInfo.flags = VK_FENCE_CREATE_SIGNALED_BIT;
+
+            if (vkd.vkCreateFence(device, &fenceInfo, nullptr, &frame.fence) != VK_SUCCESS) {
+                throw std::runtime_error("Failed to create frame fence!");
+            }
+        }
+
+        createUniformBuffer(physicalDevice, device);
+    }
+
+    //  Waits until the GPU has finished with the frame that is about to be
+    //  reused, then resets everything that frame allocated
+    //  Throws DeviceLostError if the GPU never finishes the frame
+    void beginFrame(VkDevice device) {
+
+        Frame& frame = frames[currentFrame];
+
+        checkResult(vkd.vkWaitForFences(device, 1, &frame.fence, VK_TRUE, UINT64_MAX), "Failed to wait for frame fence!");
+
+        vkd.vkResetCommandPool(device, frame.commandPool, 0);
+        vkd.vkResetDescriptorPool(device, frame.descriptorPool, 0);
+
+        frame.usedCommandBuffers = 0;
+        frame.uniformOffset = 0;
+    }
+
+    void endFrame() {
+        currentFrame = (currentFrame + 1) % MAX_FRAMES_IN_FLIGHT;
+    }
+
+    //  Hands out a primary command buffer for the current frame
+    //  A new one is only allocated the first time a frame needs more than before
+    VkCommandBuffer allocateCommandBuffer(VkDevice device) {
+
+        Frame& frame = frames[currentFrame];
+
+        if (frame.usedCommandBuffers == frame.commandBuffers.size()) {
+
+            VkCommandBufferAllocateInfo allocInfo{};
+            allocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+            allocInfo.commandPool = frame.commandPool;
+            allocInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+            allocInfo.commandBufferCount = 1;
+
+            VkCommandBuffer commandBuffer;
+
+            if (vkd.vkAllocateCommandBuffers(device, &allocInfo, &commandBuffer) != VK_SUCCESS) {
+                throw std::runtime_error("Failed to allocate frame command buffer!");
+            }
+
+            frame.commandBuffers.push_back(commandBuffer);
+        }
+
+        return frame.commandBuffers[frame.usedCommandBuffers++];
+    }
+
+    //  Descriptor sets come straight out of the frame's pool and are
+    //  released together when the pool is reset in `beginFrame`
+    VkDescriptorSet allocateDescriptorSet(VkDevice device, VkDescriptorSetLayout layout) {
+
+        VkDescriptorSetAllocateInfo allocInfo{};
+        allocInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+        allocInfo.descriptorPool = frames[currentFrame].descriptorPool;
+        allocInfo.descriptorSetCount = 1;
+        allocInfo.pSetLayouts = &layout;
+
+        VkDescriptorSet descriptorSet;
+
+        if (vkd.vkAllocateDescriptorSets(device, &allocInfo, &descriptorSet) != VK_SUCCESS) {
+            throw std::runtime_error("Frame descriptor pool exhausted!");
+        }
+
+        return descriptorSet;
+    }
+
+    //  Bump allocates `size` bytes of uniform data for the current frame
+    //  The memory is host coherent so no flush is needed after writing
+    UniformAllocation allocateUniform(VkDeviceSize size) {
+
+        Frame& frame = frames[currentFrame];
+
+        VkDeviceSize offset = (frame.uniformOffset + uniformAlignment - 1) & ~(uniformAlignment - 1);
+
+        if (offset + size > UNIFORM_ARENA_SIZE) {
+            throw std::runtime_error("Frame uniform arena exhausted!");
+        }
+
+        frame.uniformOffset = offset + size;
+
+        VkDeviceSize absoluteOffset = currentFrame * UNIFORM_ARENA_SIZE + offset;
+
+        return { static_cast<char*>(mappedUniforms) + absoluteOffset, static_cast<uint32_t>(absoluteOffset) };
+    }
+
+    //  Submits with the current frame's fence so `beginFrame` knows when
+    //  the frame's resources can be reset
+    void submit(VkDevice device, VkQueue queue, const VkSubmitInfo& submitInfo) {
+
+        Frame& frame = frames[currentFrame];
+
+        vkd.vkResetFences(device, 1, &frame.fence);
+
+        checkResult(vkd.vkQueueSubmit(queue, 1, &submitInfo, frame.fence), "Failed to submit frame command buffers!");
+        frameStats::submitted();
+    }
+
+    void cleanupFrameResources(VkDevice device) {
+
+        //  Make sure no frame is still in use by the GPU
+        //  On a lost device this returns VK_ERROR_DEVICE_LOST straight away, the objects can still be destroyed
+        vkd.vkDeviceWaitIdle(device);
+
+        for (Frame& frame : frames) {
+            vkd.vkDestroyFence(device, frame.fence, nullptr);
+            vkd.vkDestroyDescriptorPool(device, frame.descriptorPool, nullptr);
+
+            //  Destroying the pool frees the command buffers allocated from it
+            vkd.vkDestroyCommandPool(device, frame.commandPool, nullptr);
+
+            frame = Frame{};
+        }
+
+        vkd.vkUnmapMemory(device, uniformBufferMemory);
+        bufferHandler.destroyBuffer(device, uniformBuffer, uniformBufferMemory);
+
+        mappedUniforms = nullptr;
+    }
+
+private:
+
+    BufferHandler bufferHandler;
+
+    VkDeviceSize uniformAlignment = 256;
+    void* mappedUniforms = nullptr;
+
+    void createUniformBuffer(VkPhysicalDevice physicalDevice, VkDevice device) {
+
+        VkDeviceSize size = UNIFORM_ARENA_SIZE * MAX_FRAMES_IN_FLIGHT;
+
+        bufferHandler.createBuffer(physicalDevice, device, size, VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, uniformBuffer, uniformBufferMemory);
+
+        //  Persistently mapped, it is only unmapped in `cleanupFrameResources`
+        if (vkd.vkMapMemory(device, uniformBufferMemory, 0, size, 0, &mappedUniforms) != VK_SUCCESS) {
+            throw std::runtime_error("Failed to map uniform buffer memory!");
+        }
+    }
+
+};
+
+#endif /* frameResourcesHandler_h */
@@ -0,0 +1,129 @@
+#ifndef frameStats_h
+#define frameStats_h
+
+#define GLFW_INCLUDE_VULKAN
+#include <GLFW/glfw3.h>
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <memory_resource> // pooled nodes for the allocation table
+#include <mutex>
+#include <unordered_map>
+
+//  Counters behind `StatsHandler`, bumped by the counting wrappers the
+//  dispatch table installs over the driver's entry points, so every object
+//  created or destroyed through `vkd` is seen without touching the call sites
+//  Surfaces are created by GLFW, not through `vkd`, and are not counted
+//  Submits and draws are hot paths that stay direct calls into the driver,
+//  they are counted where they are made instead
+#define FRAME_STATS_OBJECT_TYPES(X) \
+    X(Buffer) \
+    X(Image) \
+    X(ImageView) \
+    X(DeviceMemory) \
+    X(Semaphore) \
+    X(Fence) \
+    X(CommandPool) \
+    X(DescriptorPool) \
+    X(ShaderModule) \
+    X(PipelineLayout) \
+    X(Pipeline) \
+    X(RenderPass) \
+    X(Framebuffer) \
+    X(Swapchain)
+
+namespace frameStats {
+
+    enum class ObjectType {
+#define FRAME_STATS_ENUM(name) name,
+        FRAME_STATS_OBJECT_TYPES(FRAME_STATS_ENUM)
+#undef FRAME_STATS_ENUM
+        Count
+    };
+
+    constexpr size_t OBJECT_TYPE_COUNT = static_cast<size_t>(ObjectType::Count);
+
+    inline const char* objectTypeName(ObjectType type) {
+        switch (type) {
+#define FRAME_STATS_NAME(name) case ObjectType::name: return #name;
+            FRAME_STATS_OBJECT_TYPES(FRAME_STATS_NAME)
+#undef FRAME_STATS_NAME
+            default: return "Unknown";
+        }
+    }
+
+    //  Objects are created and destroyed from the worker threads as well,
+    //  shader modules by the watcher and textures by the streamer
+    inline std::array<std::atomic<int64_t>, OBJECT_TYPE_COUNT> liveObjects{};
+
+    //  Running totals, `StatsHandler` turns them into per frame numbers
+    inline std::atomic<uint64_t> memoryAllocations{0};
+
+    //  Only the render thread submits and records draws, and it is also the
+    //  thread `StatsHandler` reads them on, so they are plain counters
+    inline uint64_t submits = 0;
+    inline uint64_t draws = 0;
+
+    //  Bytes held in every memory type, used for heap usage when the driver
+    //  does not report it through VK_EXT_memory_budget
+    inline std::array<std::atomic<uint64_t>, VK_MAX_MEMORY_TYPES> allocatedBytes{};
+
+    inline void objectCreated(ObjectType type, int64_t count = 1) {
+        liveObjects[static_cast<size_t>(type)].fetch_add(count, std::memory_order_relaxed);
+    }
+
+    inline void objectDestroyed(ObjectType type) {
+        liveObjects[static_cast<size_t>(type)].fetch_sub(1, std::memory_order_relaxed);
+    }
+
+    inline void submitted() {
+        submits++;
+    }
+
+    inline void drawsRecorded(uint64_t count) {
+        draws += count;
+    }
+
+    //  vkFreeMemory only gets the handle, so the size and type of every live
+    //  allocation are kept until it is freed
+    struct Allocation {
+        uint32_t memoryTypeIndex;
+        VkDeviceSize size;
+    };
+
+    //  Freed nodes go back to the pool, once it has grown to the number of
+    //  live allocations new ones are served without touching the heap
+    struct AllocationTable {
+        std::mutex mutex;
+        std::pmr::unsynchronized_pool_resource pool;
+        std::pmr::unordered_map<VkDeviceMemory, Allocation> allocations{&pool};
+    };
+
+    inline AllocationTable allocationTable;
+
+    inline void memoryAllocated(VkDeviceMemory memory, uint32_t memoryTypeIndex, VkDeviceSize size) {
+
+        memoryAllocations.fetch_add(1, std::memory_order_relaxed);
+        objectCreated(ObjectType::DeviceMemory);
+        allocatedBytes[memoryTypeIndex].fetch_add(size, std::memory_order_relaxed);
+
+        std::lock_guard<std::mutex> lock(allocationTable.mutex);
+        allocationTable.allocations[memory] = { memoryTypeIndex, size };
+    }
+
+    inline void memoryFreed(VkDeviceMemory memory) {
+
+        objectDestroyed(ObjectType::DeviceMemory);
+
+        std::lock_guard<std::mutex> lock(allocationTable.mutex);
+        auto allocation = allocationTable.allocations.find(memory);
+
+        if (allocation != allocationTable.allocations.end()) {
+            allocatedBytes[allocation->second.memoryTypeIndex].fetch_sub(allocation->second.size, std::memory_order_relaxed);
+            allocationTable.allocations.erase(allocation);
+        }
+    }
+
+}
+
+#endif /* frameStats_h */
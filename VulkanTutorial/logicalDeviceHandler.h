@@ -17,7 +17,7 @@ class LogicalDeviceHandler {
 public:
     
     //  To store the logical device
-    VkDevice device;
+    VkDevice device = VK_NULL_HANDLE;
     
     //  The queues are automatically created along with the logical device
     
@@ -27,16 +27,34 @@ public:
     //  presentation queue handler
     VkQueue presentQueue;
     
-    void createLogicalDevice(VkPhysicalDevice physicalDevice, VkSurfaceKHR surface){
+    //  The queue families the queues above were taken from,
+    //  command pools must be created against one of these
+    QueueFamiliesHandler::QueueFamilyIndices queueFamilyIndices;
+    
+    //  The features the device was created with, formats that need a
+    //  feature may only be used if it is enabled here
+    VkPhysicalDeviceFeatures enabledFeatures{};
+    
+    //  Whether the device was created with VK_EXT_memory_budget
+    bool memoryBudgetEnabled = false;
+    
+    //  `surfaces` are every surface the device will present to, empty when headless
+    //  `enableMemoryBudget` only if the physical device supports VK_EXT_memory_budget
+    void createLogicalDevice(VkPhysicalDevice physicalDevice, const std::vector<VkSurfaceKHR>& surfaces, bool enableMemoryBudget = false){
         
         //  The creation involves specifying a bunch of details in structs
         //  The first one will be `VkDeviceQueueCreateInfo`
         //  This structure describes the number of queues we want for a single queue family
         
-        QueueFamiliesHandler::QueueFamilyIndices indices = queueFamiliesHandler.findQueueFamilies(physicalDevice, surface);
+        QueueFamiliesHandler::QueueFamilyIndices indices = queueFamiliesHandler.findQueueFamilies(physicalDevice, surfaces);
         
-        std::vector<VkDeviceQueueCreateInfo> queueCreateInfos;
-        std::set<uint32_t> uniqueQueueFamilies = { indices.graphicsFamily.value(), indices.presentFamily.value() };
+        //  Both containers only live for this call, so they share a stack buffer
+        //  instead of allocating their nodes and storage on the heap
+        std::array<std::byte, 512> scratchBuffer;
+        std::pmr::monotonic_buffer_resource scratch(scratchBuffer.data(), scratchBuffer.size());
+        
+        std::pmr::vector<VkDeviceQueueCreateInfo> queueCreateInfos(&scratch);
+        std::pmr::set<uint32_t> uniqueQueueFamilies({ indices.graphicsFamily.value(), indices.presentFamily.value() }, &scratch);
         
         //  Vulkan allows to assign priorities to queues to influence the scheduling of
         //  command buffer execution using floating point numbers between 0.0 and 1.0
@@ -57,8 +75,17 @@ public:
         
         //  Specifying the device features that will be used
         
+        VkPhysicalDeviceFeatures supportedFeatures;
+        vkd.vkGetPhysicalDeviceFeatures(physicalDevice, &supportedFeatures);
+        
         VkPhysicalDeviceFeatures deviceFeatures{};
         
+        //  Block compressed texture formats, every family the device supports is enabled
+        //  so the texture pipeline can transcode to whichever fits best
+        deviceFeatures.textureCompressionBC = supportedFeatures.textureCompressionBC;
+        deviceFeatures.textureCompressionASTC_LDR = supportedFeatures.textureCompressionASTC_LDR;
+        deviceFeatures.textureCompressionETC2 = supportedFeatures.textureCompressionETC2;
+        
         //  Creating the logical device
         //  With the previous two structures in place, the main VkDeviceCreateInfo can now be filled
         VkDeviceCreateInfo createInfo{};
@@ -70,15 +97,49 @@ public:
         createInfo.queueCreateInfoCount = static_cast<uint32_t>(queueCreateInfos.size());
         createInfo.pEnabledFeatures = &deviceFeatures;
         
+        //  Swapchains are a device extension, only needed when there is something to present to
+        //  The memory budget extension lets the heap usage be read back for the frame stats
+        std::pmr::vector<const char*> deviceExtensions(&scratch);
+        
+        if (!surfaces.empty()) {
+            deviceExtensions.push_back(VK_KHR_SWAPCHAIN_EXTENSION_NAME);
+        }
+        
+        if (enableMemoryBudget) {
+            deviceExtensions.push_back(VK_EXT_MEMORY_BUDGET_EXTENSION_NAME);
+        }
+        
+        createInfo.enabledExtensionCount = static_cast<uint32_t>(deviceExtensions.size());
+        createInfo.ppEnabledExtensionNames = deviceExtensions.data();
+        
         // Instantiate the logical device
-        if (vkCreateDevice(physicalDevice, &createInfo, nullptr, &device) != VK_SUCCESS) {
+        if (vkd.vkCreateDevice(physicalDevice, &createInfo, nullptr, &device) != VK_SUCCESS) {
             
             throw std::runtime_error("Failed to create logical device!");
         }
         
-        vkGetDeviceQueue(device, indices.graphicsFamily.value(), 0, &graphicsQueue);
-        vkGetDeviceQueue(device, indices.presentFamily.value(), 0, &presentQueue);
+        //  Device functions are loaded straight from the driver, skipping the loader
+        vkd.loadDevice(device);
+        
+        vkd.vkGetDeviceQueue(device, indices.graphicsFamily.value(), 0, &graphicsQueue);
+        vkd.vkGetDeviceQueue(device, indices.presentFamily.value(), 0, &presentQueue);
+        
+        queueFamilyIndices = indices;
+        enabledFeatures = deviceFeatures;
+        memoryBudgetEnabled = enableMemoryBudget;
+        
+    }
+    
+    //  Every object created from the device must be destroyed before this,
+    //  even when the device has been lost
+    //  The device can then be created again with `createLogicalDevice`
+    void destroyLogicalDevice() {
+        
+        vkd.vkDestroyDevice(device, nullptr);
         
+        device = VK_NULL_HANDLE;
+        graphicsQueue = VK_NULL_HANDLE;
+        presentQueue = VK_NULL_HANDLE;
     }
     
 };
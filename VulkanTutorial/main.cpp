@@ -1,18 +1,39 @@
 #include "physicalDeviceHandler.hpp"
 #include "logicalDeviceHandler.h"
 #include "surfaceHandler.h"
+#include "presentationHandler.h"
+#include "frameResourcesHandler.h"
+#include "textureStreamingHandler.h"
+#include "compressedTextureHandler.h"
+#include "shaderHandler.h"
+#include "statsHandler.h"
+#include "frameArena.h"
+#include "allocationCounter.h"
+#include "vulkanErrors.h"
 
 class HelloTriangleApplication {
     
     PhysicalDeviceHandler physicalDeviceHandler;
     LogicalDeviceHandler logicalDeviceHandler;
     SurfaceHandler surfaceHandler;
+    PresentationHandler presentationHandler;
+    FrameResourcesHandler frameResourcesHandler;
+    TextureStreamingHandler textureStreamingHandler;
+    CompressedTextureHandler compressedTextureHandler;
+    ShaderHandler shaderHandler;
+    StatsHandler statsHandler;
+    
+    /// transient CPU side data for the frame being recorded, reset at the start of every frame
+    FrameArena frameArena;
     
 public:
     
     const uint32_t WIDTH = 800;
     const uint32_t HEIGHT = 600;
     
+    /// every window gets its own surface and swapchain, all of them are driven by the same device
+    const uint32_t WINDOW_COUNT = 2;
+    
     const std::vector<const char*> validationLayers = {
         "VK_LAYER_KHRONOS_validation"
     };
@@ -24,6 +45,20 @@ public:
     const bool enableValidationLayers = true;
 #endif
     
+/// shader hot reload is on in debug builds, define `SHADER_HOT_RELOAD` to keep it in release builds for perf tuning
+#if defined(SHADER_HOT_RELOAD) || !defined(NDEBUG)
+    const bool enableShaderHotReload = true;
+#else
+    const bool enableShaderHotReload = false;
+#endif
+    
+/// define `FRAME_STATS_FILE` as a path to write every frame's stats to it as a line of JSON, e.g. `-DFRAME_STATS_FILE=\"frameStats.jsonl\"`
+#ifdef FRAME_STATS_FILE
+    const char* frameStatsFile = FRAME_STATS_FILE;
+#else
+    const char* frameStatsFile = nullptr;
+#endif
+    
     void run(){
         initWindow();
         initVulkan();
@@ -33,11 +68,19 @@ public:
     
 private:
     
-    GLFWwindow* window;
+    std::vector<GLFWwindow*> windows;
     VkInstance instance;
     uint32_t glfwExtensionCount = 0;
     const char** glfwExtensions;
     
+    /// VK_KHR_get_physical_device_properties2 is needed to read the heap budgets of a 1.0 instance
+    bool physicalDeviceProperties2Enabled = false;
+    
+    /// fault injection for the device loss recovery, see `simulateDeviceLoss`
+    uint64_t simulatedLossFrame = UINT64_MAX;
+    uint32_t simulatedRecoveryFailures = 0;
+    bool simulateLossKeyHeld = false;
+    
     /// To initialize GLFW
     void initWindow() {
         
@@ -50,8 +93,11 @@ private:
         /// 3. Disable windows resize for now. Takes special care to handle resize
         glfwWindowHint(GLFW_RESIZABLE, GLFW_FALSE);
         
-        /// 4. Create the actual window
-        window = glfwCreateWindow(800, 600, "Vulkan Tutorial", nullptr, nullptr);
+        /// 4. Create the actual windows
+        for (uint32_t i = 0; i < WINDOW_COUNT; i++) {
+            std::string title = "Vulkan Tutorial " + std::to_string(i + 1);
+            windows.push_back(glfwCreateWindow(WIDTH, HEIGHT, title.c_str(), nullptr, nullptr));
+        }
         
     }
     
@@ -59,6 +105,9 @@ private:
     /// the instance is the connection between the application and the vulkan library
     void createInstance(){
         
+        /// every call goes through `vkd`, the functions that do not need an instance are loaded first
+        vkd.loadGlobal();
+        
         /// validation layer check
         if (enableValidationLayers && !checkValidationLayerSupport()){
             throw std::runtime_error("Validation Layer Requested, but not found");
@@ -129,10 +178,10 @@ private:
         
         //  FROM HERE: Check extensions
         uint32_t extensionCount = 0;
-        vkEnumerateInstanceExtensionProperties(nullptr, &extensionCount, nullptr);
+        vkd.vkEnumerateInstanceExtensionProperties(nullptr, &extensionCount, nullptr);
         
         std::vector<VkExtensionProperties> extensions(extensionCount);
-        vkEnumerateInstanceExtensionProperties(nullptr, &extensionCount, extensions.data());
+        vkd.vkEnumerateInstanceExtensionProperties(nullptr, &extensionCount, extensions.data());
         
 //        std::cout << "available extensions:\n";
 //        
@@ -141,6 +190,17 @@ private:
 //        }
         
         //  TO HERE
+        
+        /// optional, the frame stats fall back to counting allocations themselves without it
+        for (const auto& extension : extensions) {
+            if (strcmp(extension.extensionName, VK_KHR_GET_PHYSICAL_DEVICE_PROPERTIES_2_EXTENSION_NAME) == 0) {
+                requiredExtensions.emplace_back(VK_KHR_GET_PHYSICAL_DEVICE_PROPERTIES_2_EXTENSION_NAME);
+                physicalDeviceProperties2Enabled = true;
+            }
+        }
+        
+        createInfo.enabledExtensionCount = static_cast<uint32_t>(requiredExtensions.size());
+        createInfo.ppEnabledExtensionNames = requiredExtensions.data();
     
         
         /// create the instance and store the result in the `result` variable
@@ -151,11 +211,13 @@ private:
         
         std::cout << &instance << ": instance checking" << std::endl;
         
-        if (vkCreateInstance(&createInfo, nullptr, &instance) != VK_SUCCESS) {
+        if (vkd.vkCreateInstance(&createInfo, nullptr, &instance) != VK_SUCCESS) {
             
             throw std::runtime_error("Failed to create Instance!");
         }
         
+        vkd.loadInstance(instance);
+        
     }
 
     void initVulkan() {
@@ -163,16 +225,266 @@ private:
         handleSurface();
         handlePhysicalDevice();
         handleLogicalDevice();
+        handleStats();
+        handleFrameResources();
+        handlePresentation();
+        handleTextureStreaming();
+        handleShaders();
+        handleFaultInjection();
     }
     
     /// to render frames
     void mainLoop(){
         
         /// To keep the application running until either an error occurs or the window is closed, add ab event loop
-        while (!glfwWindowShouldClose(window)) {
+        /// the first frames are allowed to allocate while the pools and the arena grow to their working size
+        const uint64_t warmupFrames = 8;
+        uint64_t frameCount = 0;
+        uint64_t warmupEnd = warmupFrames;
+        
+        /// closing any of the windows ends the application
+        while (!anyWindowShouldClose()) {
+            uint64_t allocationsBefore = allocationCounter::count();
+            
             glfwPollEvents();
+            
+            /// losing the device or the surface is recovered from in place, anything else still ends the program
+            bool lost = false;
+            bool surfaceLost = false;
+            
+            try {
+                simulateDeviceLoss(frameCount);
+                drawFrame();
+            } catch (const DeviceLostError& e) {
+                std::cerr << e.what() << std::endl;
+                lost = true;
+            } catch (const SurfaceLostError& e) {
+                std::cerr << e.what() << std::endl;
+                lost = true;
+                surfaceLost = true;
+            }
+            
+            /// outside the handlers, so losing the device again while recovering is caught by `recover` itself
+            if (lost) {
+                recover(surfaceLost);
+                warmupEnd = frameCount + warmupFrames;
+            }
+            
+            /// with COUNT_HEAP_ALLOCATIONS defined, report any frame that still hits the heap after warm up
+            uint64_t frameAllocations = allocationCounter::count() - allocationsBefore;
+            
+            if (allocationCounter::enabled() && frameCount >= warmupEnd && frameAllocations > 0) {
+                std::cerr << "Frame " << frameCount << " made " << frameAllocations << " heap allocations" << std::endl;
+            }
+            
+            frameCount++;
+        }
+        
+    }
+    
+    void drawFrame() {
+        
+        /// reset the pools of the frame we are about to reuse once the GPU is done with it
+        frameResourcesHandler.beginFrame(logicalDeviceHandler.device);
+        frameArena.reset();
+        
+        /// pipelines rebuilt by the shader watcher are swapped in before anything is recorded
+        shaderHandler.applyReloads();
+        
+        /// one image from every window that can take one, minimized and out of date windows sit the frame out
+        /// the submit and present arrays of the frame live in the arena
+        presentationHandler.acquireImages(frameResourcesHandler.currentFrame, &frameArena);
+        
+        VkCommandBuffer commandBuffer = frameResourcesHandler.allocateCommandBuffer(logicalDeviceHandler.device);
+        recordFrame(commandBuffer);
+        
+        /// a single submit waits on every acquire, a single present hands every image back
+        VkSubmitInfo submitInfo{};
+        submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+        submitInfo.commandBufferCount = 1;
+        submitInfo.pCommandBuffers = &commandBuffer;
+        presentationHandler.addSubmitSemaphores(submitInfo);
+        
+        frameResourcesHandler.submit(logicalDeviceHandler.device, logicalDeviceHandler.graphicsQueue, submitInfo);
+        presentationHandler.presentImages(logicalDeviceHandler.presentQueue);
+        
+        frameResourcesHandler.endFrame();
+        statsHandler.collectFrame();
+    }
+    
+    /// nothing is drawn yet, every acquired image is cleared to its window's colour and made ready to present
+    void recordFrame(VkCommandBuffer commandBuffer) {
+        
+        VkCommandBufferBeginInfo beginInfo{};
+        beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+        beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+        
+        if (vkd.vkBeginCommandBuffer(commandBuffer, &beginInfo) != VK_SUCCESS) {
+            throw std::runtime_error("Failed to begin frame command buffer!");
+        }
+        
+        /// streamed texture uploads and evictions go first, so anything drawn later in the frame samples the new levels
+        /// every texture drawn this frame has to be passed to `requestMip` before this
+        textureStreamingHandler.update(commandBuffer, frameResourcesHandler.currentFrame);
+        
+        for (size_t i = 0; i < presentationHandler.outputs.size(); i++) {
+            const PresentationHandler::Output& output = presentationHandler.outputs[i];
+            
+            if (!output.acquired) {
+                continue;
+            }
+            
+            VkImage image = output.swapchainHandler.images[output.imageIndex];
+            
+            /// the previous contents are never needed, so every frame starts from UNDEFINED
+            if (output.swapchainHandler.canClear()) {
+                transitionSwapchainImage(commandBuffer, image, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 0, VK_ACCESS_TRANSFER_WRITE_BIT, PresentationHandler::ACQUIRE_WAIT_STAGES, VK_PIPELINE_STAGE_TRANSFER_BIT);
+                
+                VkClearColorValue clearColor = {{ 0.1f, 0.1f + 0.3f * static_cast<float>(i), 0.3f, 1.0f }};
+                VkImageSubresourceRange range = { VK_IMAGE_ASPECT_COLOR_BIT, 0, 1, 0, 1 };
+                vkd.vkCmdClearColorImage(commandBuffer, image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, &clearColor, 1, &range);
+                
+                transitionSwapchainImage(commandBuffer, image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_IMAGE_LAYOUT_PRESENT_SRC_KHR, VK_ACCESS_TRANSFER_WRITE_BIT, 0, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT);
+            } else {
+                transitionSwapchainImage(commandBuffer, image, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_PRESENT_SRC_KHR, 0, 0, PresentationHandler::ACQUIRE_WAIT_STAGES, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT);
+            }
         }
         
+        if (vkd.vkEndCommandBuffer(commandBuffer) != VK_SUCCESS) {
+            throw std::runtime_error("Failed to record frame command buffer!");
+        }
+    }
+    
+    void transitionSwapchainImage(VkCommandBuffer commandBuffer, VkImage image, VkImageLayout oldLayout, VkImageLayout newLayout, VkAccessFlags srcAccess, VkAccessFlags dstAccess, VkPipelineStageFlags srcStage, VkPipelineStageFlags dstStage) {
+        
+        VkImageMemoryBarrier barrier{};
+        barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+        barrier.oldLayout = oldLayout;
+        barrier.newLayout = newLayout;
+        barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+        barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+        barrier.image = image;
+        barrier.subresourceRange = { VK_IMAGE_ASPECT_COLOR_BIT, 0, 1, 0, 1 };
+        barrier.srcAccessMask = srcAccess;
+        barrier.dstAccessMask = dstAccess;
+        
+        vkd.vkCmdPipelineBarrier(commandBuffer, srcStage, dstStage, 0, 0, nullptr, 0, nullptr, 1, &barrier);
+    }
+    
+    bool anyWindowShouldClose() {
+        
+        for (GLFWwindow* window : windows) {
+            if (glfwWindowShouldClose(window)) {
+                return true;
+            }
+        }
+        
+        return false;
+    }
+    
+    /// runs `recoverDevice` until it gets through, the device or a surface can be lost again while the swapchains are recreated
+    /// every failed attempt is followed by the full rebuild, surfaces included, a few of them in a row mean the GPU is not coming back
+    void recover(bool surfaceLost) {
+        
+        const uint32_t maxAttempts = 3;
+        
+        for (uint32_t attempt = 1; ; attempt++) {
+            
+            std::string error;
+            
+            try {
+                recoverDevice(surfaceLost);
+                return;
+            } catch (const DeviceLostError& e) {
+                error = e.what();
+            } catch (const SurfaceLostError& e) {
+                error = e.what();
+            }
+            
+            if (attempt == maxAttempts) {
+                throw std::runtime_error("Failed to recover from device loss: " + error);
+            }
+            
+            std::cerr << "Recovery attempt " << attempt << " failed: " << error << std::endl;
+            surfaceLost = true;
+        }
+    }
+    
+    /// tear down everything created from the device and build it again without touching the instance or the window
+    /// every object has to be destroyed before `vkDestroyDevice`, even on a lost device, so this runs in the same order as `cleanup`
+    /// textures come back from their host shadow and shaders from their SPIR-V files, so this takes milliseconds rather than a restart
+    /// safe to run again after it threw part way, whatever it already released is skipped
+    void recoverDevice(bool surfaceLost) {
+        
+        auto start = std::chrono::steady_clock::now();
+        
+        shaderHandler.releaseDeviceObjects();
+        textureStreamingHandler.releaseDeviceResources();
+        
+        /// a failed attempt may have thrown after destroying the device and before creating the next one
+        if (logicalDeviceHandler.device != VK_NULL_HANDLE) {
+            presentationHandler.cleanupOutputs(logicalDeviceHandler.device);
+            frameResourcesHandler.cleanupFrameResources(logicalDeviceHandler.device);
+            logicalDeviceHandler.destroyLogicalDevice();
+        }
+        
+        /// the device has to go first, its present queue was chosen against the old surfaces
+        if (surfaceLost) {
+            surfaceHandler.recreateSurfaces(instance, windows);
+        }
+        
+        physicalDeviceHandler.recoverPhysicalDevice(instance, surfaceHandler.surfaces);
+        handleLogicalDevice();
+        statsHandler.setupStats(physicalDeviceHandler.physicalDevice, logicalDeviceHandler.memoryBudgetEnabled);
+        handleFrameResources();
+        
+        /// stands in for a swapchain creation that loses the device, leaving a half rebuilt device behind
+        if (simulatedRecoveryFailures > 0) {
+            simulatedRecoveryFailures--;
+            throw DeviceLostError("Simulated device loss during recovery");
+        }
+        
+        handlePresentation();
+        textureStreamingHandler.restoreDeviceResources(physicalDeviceHandler.physicalDevice, logicalDeviceHandler.device);
+        compressedTextureHandler.queryFormatSupport(physicalDeviceHandler.physicalDevice, logicalDeviceHandler.enabledFeatures);
+        shaderHandler.restoreDeviceObjects(logicalDeviceHandler.device);
+        
+        auto elapsed = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+        std::cout << "Recovered from " << (surfaceLost ? "surface" : "device") << " loss in " << elapsed << " ms" << std::endl;
+    }
+    
+    /// throws the same error a real device loss does, so the whole recovery path can be exercised on a healthy GPU
+    /// F9 loses the device at the next frame in debug builds, `SIMULATE_DEVICE_LOSS` at the frame it holds
+    void simulateDeviceLoss(uint64_t frameCount) {
+        
+        bool keyPressed = false;
+        
+#ifndef NDEBUG
+        for (GLFWwindow* window : windows) {
+            keyPressed |= glfwGetKey(window, GLFW_KEY_F9) == GLFW_PRESS;
+        }
+#endif
+        
+        /// only the press itself counts, not every frame the key is held for
+        bool keyDown = keyPressed && !simulateLossKeyHeld;
+        simulateLossKeyHeld = keyPressed;
+        
+        if (keyDown || frameCount == simulatedLossFrame) {
+            throw DeviceLostError("Simulated device loss at frame " + std::to_string(frameCount));
+        }
+    }
+    
+    /// `SIMULATE_DEVICE_LOSS=<frame>` loses the device at that frame
+    /// `SIMULATE_RECOVERY_FAILURES=<count>` makes that many recovery attempts lose the device again part way, up to `recover`'s limit still recovers
+    void handleFaultInjection() {
+        
+        if (const char* frame = std::getenv("SIMULATE_DEVICE_LOSS")) {
+            simulatedLossFrame = std::strtoull(frame, nullptr, 10);
+        }
+        
+        if (const char* failures = std::getenv("SIMULATE_RECOVERY_FAILURES")) {
+            simulatedRecoveryFailures = static_cast<uint32_t>(std::strtoul(failures, nullptr, 10));
+        }
     }
     
     /// once window is closed and mainLoop returns, resources will be deallocated using this function
@@ -180,10 +492,23 @@ private:
     /// VkInstance should be only destroyed right before the program exits. It can be destroyed using the `vkDestroyInstance` function
     /// The device should be destroyed before instance termination
     void cleanup() {
-        vkDestroyDevice(logicalDeviceHandler.device, nullptr);
-        vkDestroySurfaceKHR(instance, surfaceHandler.surface, nullptr);
-        vkDestroyInstance(instance, nullptr);
-        glfwDestroyWindow(window);
+        shaderHandler.cleanupShaderHandler(logicalDeviceHandler.device);
+        textureStreamingHandler.cleanupTextureStreaming(logicalDeviceHandler.device);
+        presentationHandler.cleanupOutputs(logicalDeviceHandler.device);
+        frameResourcesHandler.cleanupFrameResources(logicalDeviceHandler.device);
+        logicalDeviceHandler.destroyLogicalDevice();
+        
+        /// every object created through `vkd` is gone by now, anything still counted was leaked
+        statsHandler.reportLeaks();
+        statsHandler.cleanupStats();
+        
+        surfaceHandler.destroySurfaces(instance);
+        vkd.vkDestroyInstance(instance, nullptr);
+        
+        for (GLFWwindow* window : windows) {
+            glfwDestroyWindow(window);
+        }
+        
         glfwTerminate();
     }
     
@@ -195,13 +520,16 @@ private:
         uint32_t layerCount;
         
         /// why is this initialized with a null pointer
-        vkEnumerateInstanceLayerProperties(&layerCount, nullptr);
+        vkd.vkEnumerateInstanceLayerProperties(&layerCount, nullptr);
         
         /// declare vector of type `VkLayerProperties` and size `layerCount`
-        std::vector<VkLayerProperties> availableLayers(layerCount);
+        /// the storage comes from a stack buffer, it only spills to the heap if there are a lot of layers installed
+        std::array<std::byte, 8192> scratchBuffer;
+        std::pmr::monotonic_buffer_resource scratch(scratchBuffer.data(), scratchBuffer.size());
+        std::pmr::vector<VkLayerProperties> availableLayers(layerCount, &scratch);
         
         /// and why is this reinitialized with the vector
-        vkEnumerateInstanceLayerProperties(&layerCount, availableLayers.data());
+        vkd.vkEnumerateInstanceLayerProperties(&layerCount, availableLayers.data());
         
         /// next, check if all of  the layers in `validationLayers` exist in the `availableLayers` list
         /// #include <cstring> for strcmp
@@ -229,15 +557,49 @@ private:
     
     
     void handlePhysicalDevice() {
-        physicalDeviceHandler.pickPhysicalDevice(instance, surfaceHandler.surface);
+        physicalDeviceHandler.pickPhysicalDevice(instance, surfaceHandler.surfaces);
     }
     
     void handleLogicalDevice() {
-        logicalDeviceHandler.createLogicalDevice(physicalDeviceHandler.physicalDevice, surfaceHandler.surface);
+        bool memoryBudget = physicalDeviceProperties2Enabled && physicalDeviceHandler.supportsExtension(physicalDeviceHandler.physicalDevice, VK_EXT_MEMORY_BUDGET_EXTENSION_NAME);
+        logicalDeviceHandler.createLogicalDevice(physicalDeviceHandler.physicalDevice, surfaceHandler.surfaces, memoryBudget);
+    }
+    
+    /// heap usage, live objects and per frame counts, read back through `statsHandler.stats` or the export file
+    void handleStats() {
+        statsHandler.setupStats(physicalDeviceHandler.physicalDevice, logicalDeviceHandler.memoryBudgetEnabled);
+        
+        if (frameStatsFile != nullptr) {
+            statsHandler.openExport(frameStatsFile);
+        }
+    }
+    
+    void handleFrameResources() {
+        frameResourcesHandler.createFrameResources(physicalDeviceHandler.physicalDevice, logicalDeviceHandler.device, logicalDeviceHandler.queueFamilyIndices.graphicsFamily.value());
+    }
+    
+    /// the VRAM budget is taken from the memory heaps of the device `PhysicalDeviceHandler` selected
+    void handleTextureStreaming() {
+        textureStreamingHandler.createTextureStreaming(physicalDeviceHandler.physicalDevice, logicalDeviceHandler.device);
+        compressedTextureHandler.queryFormatSupport(physicalDeviceHandler.physicalDevice, logicalDeviceHandler.enabledFeatures);
+    }
+    
+    void handleShaders() {
+        shaderHandler.createShaderHandler(logicalDeviceHandler.device);
+        
+        if (enableShaderHotReload) {
+            shaderHandler.startHotReload();
+        }
     }
     
     void handleSurface() {
-        surfaceHandler.createSurface(instance, window);
+        for (GLFWwindow* window : windows) {
+            surfaceHandler.createSurface(instance, window);
+        }
+    }
+    
+    void handlePresentation() {
+        presentationHandler.createOutputs(physicalDeviceHandler.physicalDevice, logicalDeviceHandler.device, logicalDeviceHandler.queueFamilyIndices, windows, surfaceHandler.surfaces);
     }
     
     
@@ -16,13 +16,13 @@ public:
     VkPhysicalDevice physicalDevice = VK_NULL_HANDLE;
     QueueFamiliesHandler queueFamiliesHandler;
     
-    void pickPhysicalDevice(VkInstance instance, VkSurfaceKHR surface) {
+    void pickPhysicalDevice(VkInstance instance, const std::vector<VkSurfaceKHR>& surfaces) {
         
         
         
         
         //  Query the number of physical devices
-        vkEnumeratePhysicalDevices(instance, &physicalDeviceCount, nullptr);
+        vkd.vkEnumeratePhysicalDevices(instance, &physicalDeviceCount, nullptr);
         
         //  validate the gpu count
         if (physicalDeviceCount == 0) {
@@ -30,8 +30,11 @@ public:
         }
         
         //  Declare a vector to hold all physical devices
-        std::vector<VkPhysicalDevice> physicalDevices(physicalDeviceCount);
-        vkEnumeratePhysicalDevices(instance, &physicalDeviceCount, physicalDevices.data());
+        //  Backed by a stack buffer so enumeration does not touch the heap
+        std::array<std::byte, 256> scratchBuffer;
+        std::pmr::monotonic_buffer_resource scratch(scratchBuffer.data(), scratchBuffer.size());
+        std::pmr::vector<VkPhysicalDevice> physicalDevices(physicalDeviceCount, &scratch);
+        vkd.vkEnumeratePhysicalDevices(instance, &physicalDeviceCount, physicalDevices.data());
         
         
         //  log out the number of detected gpus with vulkan support
@@ -40,7 +43,7 @@ public:
         // If any of the GPUs meet the requirement, that GPU is selected
         for (const auto& device : physicalDevices) {
             
-            if (isDeviceSuitable(device, surface)) {
+            if (isDeviceSuitable(device, surfaces)) {
                 physicalDevice = device;
                 break;
             }
@@ -56,11 +59,44 @@ public:
         
     }
     
+    //  After a device or surface loss the instance is still valid, and so are
+    //  the physical device handles it enumerated
+    //  The current GPU is kept if it can still present to `surfaces`, so the
+    //  recovered device has the same limits and formats as before, otherwise
+    //  another one is picked
+    void recoverPhysicalDevice(VkInstance instance, const std::vector<VkSurfaceKHR>& surfaces) {
+        
+        if (physicalDevice != VK_NULL_HANDLE && isDeviceSuitable(physicalDevice, surfaces)) {
+            return;
+        }
+        
+        physicalDevice = VK_NULL_HANDLE;
+        pickPhysicalDevice(instance, surfaces);
+    }
+    
     //  Find the queue families for the device
-    //  Checks if the device supports the Graphics family queue
-    bool isDeviceSuitable(VkPhysicalDevice physicalDevice, VkSurfaceKHR surface) {
-        QueueFamiliesHandler::QueueFamilyIndices indices = queueFamiliesHandler.findQueueFamilies(physicalDevice, surface);
-        return indices.isComplete();
+    //  Checks if the device supports the Graphics family queue, and when
+    //  there is anything to present to, swapchains
+    bool isDeviceSuitable(VkPhysicalDevice physicalDevice, const std::vector<VkSurfaceKHR>& surfaces) {
+        QueueFamiliesHandler::QueueFamilyIndices indices = queueFamiliesHandler.findQueueFamilies(physicalDevice, surfaces);
+        return indices.isComplete() && (surfaces.empty() || supportsExtension(physicalDevice, VK_KHR_SWAPCHAIN_EXTENSION_NAME));
+    }
+    
+    bool supportsExtension(VkPhysicalDevice physicalDevice, const char* extensionName) {
+        
+        uint32_t extensionCount = 0;
+        vkd.vkEnumerateDeviceExtensionProperties(physicalDevice, nullptr, &extensionCount, nullptr);
+        
+        std::vector<VkExtensionProperties> extensions(extensionCount);
+        vkd.vkEnumerateDeviceExtensionProperties(physicalDevice, nullptr, &extensionCount, extensions.data());
+        
+        for (const auto& extension : extensions) {
+            if (strcmp(extension.extensionName, extensionName) == 0) {
+                return true;
+            }
+        }
+        
+        return false;
     }
     
 };
@@ -0,0 +1,240 @@
+#ifndef presentationHandler_h
+#define presentationHandler_h
+
+#include "swapchainHandler.h"
+#include <memory_resource>
+#include <optional>
+#include <vector>
+
+class PresentationHandler {
+
+    //  Drives several windows from one logical device, each with its own
+    //  surface and swapchain
+    //  Every frame an image is acquired from each output, one submit waits on
+    //  all the acquires and signals all the render finished semaphores, and a
+    //  single vkQueuePresentKHR hands every image back at once
+    //  That needs one queue able to present to every surface, which is what
+    //  `QueueFamiliesHandler` picks as the present family
+    //
+    //  Outputs that are minimized or out of date sit the frame out and are
+    //  recreated before their next acquire, the other windows keep going
+
+public:
+
+    //  The first commands touching an acquired image must wait for these stages
+    static constexpr VkPipelineStageFlags ACQUIRE_WAIT_STAGES = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT | VK_PIPELINE_STAGE_TRANSFER_BIT;
+
+    struct Output {
+        GLFWwindow* window;
+        VkSurfaceKHR surface;
+        SwapchainHandler swapchainHandler;
+
+        //  Set by `acquireImages` for the frame being recorded
+        bool acquired = false;
+        uint32_t imageIndex = 0;
+
+        //  The swapchain no longer matches the surface, it is recreated before the next acquire
+        bool outOfDate = false;
+    };
+
+    std::vector<Output> outputs;
+
+    //  One output per window, `surfaces[i]` must have been created from `windows[i]`
+    void createOutputs(VkPhysicalDevice physicalDevice, VkDevice device, const QueueFamiliesHandler::QueueFamilyIndices& indices, const std::vector<GLFWwindow*>& windows, const std::vector<VkSurfaceKHR>& surfaces) {
+
+        this->physicalDevice = physicalDevice;
+        this->device = device;
+        this->indices = indices;
+
+        outputs.resize(windows.size());
+
+        for (size_t i = 0; i < windows.size(); i++) {
+            outputs[i].window = windows[i];
+            outputs[i].surface = surfaces[i];
+            outputs[i].swapchainHandler.createSwapchain(physicalDevice, device, surfaces[i], windows[i], indices);
+        }
+    }
+
+    //  Call after `FrameResourcesHandler::beginFrame`, acquires an image from every output that can take one
+    //  Returns how many were acquired, only those are recorded, submitted and presented this frame
+    //  The frame's submit and present arrays are taken from `frameMemory`,
+    //  which has to stay valid until `presentImages` returns
+    uint32_t acquireImages(uint32_t frameIndex, std::pmr::memory_resource* frameMemory) {
+
+        uint32_t acquiredCount = 0;
+        acquireFrameIndex = frameIndex;
+
+        frameArrays.reset();
+        frameArrays.emplace(outputs.size(), frameMemory);
+
+        for (Output& output : outputs) {
+
+            output.acquired = false;
+
+            SwapchainHandler& swapchainHandler = output.swapchainHandler;
+
+            swapchainHandler.releaseRetired(device);
+
+            if (output.outOfDate || swapchainHandler.swapchain == VK_NULL_HANDLE) {
+                swapchainHandler.recreateSwapchain(physicalDevice, device, output.surface, output.window, indices);
+                output.outOfDate = false;
+            }
+
+            //  Still minimized
+            if (swapchainHandler.swapchain == VK_NULL_HANDLE) {
+                continue;
+            }
+
+            VkResult result = swapchainHandler.acquireNextImage(device, frameIndex, output.imageIndex);
+
+            //  Nothing was acquired and the semaphore is not signalled, skip the output this frame
+            if (result == VK_ERROR_OUT_OF_DATE_KHR) {
+                output.outOfDate = true;
+                continue;
+            }
+
+            //  Suboptimal still hands out an image, it is used and the swapchain recreated afterwards
+            if (result == VK_SUBOPTIMAL_KHR) {
+                output.outOfDate = true;
+            }
+
+            output.acquired = true;
+            acquiredCount++;
+        }
+
+        return acquiredCount;
+    }
+
+    //  Makes the frame's submit wait on every acquired image and signal the
+    //  semaphores their presents wait on
+    //  The arrays stay valid until the next `acquireImages`
+    void addSubmitSemaphores(VkSubmitInfo& submitInfo) {
+
+        FrameArrays& arrays = *frameArrays;
+
+        for (Output& output : outputs) {
+
+            if (!output.acquired) {
+                continue;
+            }
+
+            arrays.waitSemaphores.push_back(output.swapchainHandler.imageAvailableSemaphores[acquireFrameIndex]);
+            arrays.waitStages.push_back(ACQUIRE_WAIT_STAGES);
+            arrays.signalSemaphores.push_back(output.swapchainHandler.renderFinishedSemaphores[output.imageIndex]);
+        }
+
+        submitInfo.waitSemaphoreCount = static_cast<uint32_t>(arrays.waitSemaphores.size());
+        submitInfo.pWaitSemaphores = arrays.waitSemaphores.data();
+        submitInfo.pWaitDstStageMask = arrays.waitStages.data();
+        submitInfo.signalSemaphoreCount = static_cast<uint32_t>(arrays.signalSemaphores.size());
+        submitInfo.pSignalSemaphores = arrays.signalSemaphores.data();
+    }
+
+    //  Presents every acquired image with one vkQueuePresentKHR, after the
+    //  submit `addSubmitSemaphores` was used for
+    //  Out of date and suboptimal swapchains are only flagged for recreation,
+    //  a lost surface or device throws after the other images have been handed back
+    void presentImages(VkQueue presentQueue) {
+
+        FrameArrays& arrays = *frameArrays;
+
+        for (Output& output : outputs) {
+
+            if (!output.acquired) {
+                continue;
+            }
+
+            arrays.presentSwapchains.push_back(output.swapchainHandler.swapchain);
+            arrays.presentImageIndices.push_back(output.imageIndex);
+            arrays.presentOutputs.push_back(&output);
+            output.acquired = false;
+        }
+
+        if (arrays.presentSwapchains.empty()) {
+            return;
+        }
+
+        arrays.presentResults.resize(arrays.presentSwapchains.size());
+
+        VkPresentInfoKHR presentInfo{};
+        presentInfo.sType = VK_STRUCTURE_TYPE_PRESENT_INFO_KHR;
+        presentInfo.waitSemaphoreCount = static_cast<uint32_t>(arrays.signalSemaphores.size());
+        presentInfo.pWaitSemaphores = arrays.signalSemaphores.data();
+        presentInfo.swapchainCount = static_cast<uint32_t>(arrays.presentSwapchains.size());
+        presentInfo.pSwapchains = arrays.presentSwapchains.data();
+        presentInfo.pImageIndices = arrays.presentImageIndices.data();
+
+        //  Per swapchain results, the call's own result only reports the worst of them
+        presentInfo.pResults = arrays.presentResults.data();
+
+        VkResult result = vkd.vkQueuePresentKHR(presentQueue, &presentInfo);
+
+        //  Errors that are not about one swapchain leave `pResults` unspecified
+        if (result == VK_ERROR_DEVICE_LOST || result == VK_ERROR_OUT_OF_HOST_MEMORY || result == VK_ERROR_OUT_OF_DEVICE_MEMORY) {
+            checkResult(result, "Failed to present swapchain images!");
+        }
+
+        for (size_t i = 0; i < arrays.presentOutputs.size(); i++) {
+
+            if (arrays.presentResults[i] == VK_SUBOPTIMAL_KHR || arrays.presentResults[i] == VK_ERROR_OUT_OF_DATE_KHR) {
+                arrays.presentOutputs[i]->outOfDate = true;
+            } else {
+                checkResult(arrays.presentResults[i], "Failed to present swapchain image!");
+            }
+        }
+    }
+
+    void cleanupOutputs(VkDevice device) {
+
+        vkd.vkDeviceWaitIdle(device);
+
+        for (Output& output : outputs) {
+            output.swapchainHandler.cleanupSwapchain(device);
+        }
+
+        outputs.clear();
+
+        //  The arrays point into the frame memory, which may not outlive the handler
+        frameArrays.reset();
+    }
+
+private:
+
+    VkPhysicalDevice physicalDevice = VK_NULL_HANDLE;
+    VkDevice device = VK_NULL_HANDLE;
+    QueueFamiliesHandler::QueueFamilyIndices indices;
+
+    //  The frame in flight the images were last acquired for, so the submit waits on the right semaphores
+    uint32_t acquireFrameIndex = 0;
+
+    //  Built every frame in the frame memory, reserved for every output up
+    //  front so they never grow past the first allocation
+    struct FrameArrays {
+        std::pmr::vector<VkSemaphore> waitSemaphores;
+        std::pmr::vector<VkPipelineStageFlags> waitStages;
+        std::pmr::vector<VkSemaphore> signalSemaphores;
+
+        std::pmr::vector<VkSwapchainKHR> presentSwapchains;
+        std::pmr::vector<uint32_t> presentImageIndices;
+        std::pmr::vector<Output*> presentOutputs;
+        std::pmr::vector<VkResult> presentResults;
+
+        FrameArrays(size_t outputCount, std::pmr::memory_resource* frameMemory)
+            : waitSemaphores(frameMemory), waitStages(frameMemory), signalSemaphores(frameMemory),
+              presentSwapchains(frameMemory), presentImageIndices(frameMemory), presentOutputs(frameMemory), presentResults(frameMemory) {
+
+            waitSemaphores.reserve(outputCount);
+            waitStages.reserve(outputCount);
+            signalSemaphores.reserve(outputCount);
+            presentSwapchains.reserve(outputCount);
+            presentImageIndices.reserve(outputCount);
+            presentOutputs.reserve(outputCount);
+            presentResults.reserve(outputCount);
+        }
+    };
+
+    std::optional<FrameArrays> frameArrays;
+
+};
+
+#endif /* presentationHandler_h */
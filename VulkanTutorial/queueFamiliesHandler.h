@@ -1,14 +1,15 @@
 #ifndef queueFamiliesHandler_h
 #define queueFamiliesHandler_h
 
-#define GLFW_INCLUDE_VULKAN
-#include <GLFW/glfw3.h>
+#include "dispatchTable.h"
 #include <iostream>   // To report and propagate errors
 #include <stdexcept> // To report and propagate errors
 #include <cstdlib> //  provides the EXIT_SUCCESS and EXIT_FAILURE macros.
 #include <vector>
 #include <cstring> // for strcmp
 #include <optional> // to query if a variable contains a value
+#include <memory_resource> // stack backed scratch memory for temporaries
+#include <array>
 
 
 class QueueFamiliesHandler {
@@ -25,15 +26,18 @@ public:
     };
     
     //  Look for the queue that supports graphics command
-    //  Look for the queue that also has the capability of presenting to
-    //  the surface window using `vkGetPhysicalDeviceSurfaceSupportKHR`
-    QueueFamilyIndices findQueueFamilies(VkPhysicalDevice physicalDevice, VkSurfaceKHR surface) {
+    //  Look for a queue that can present to every one of `surfaces` using
+    //  `vkGetPhysicalDeviceSurfaceSupportKHR`, so the images of all windows
+    //  can be handed back with a single vkQueuePresentKHR
+    //  A family that does both is preferred, the frame then needs no
+    //  sharing between queue families at all
+    QueueFamilyIndices findQueueFamilies(VkPhysicalDevice physicalDevice, const std::vector<VkSurfaceKHR>& surfaces) {
         QueueFamilyIndices indices;
         
         //  Logic to find queue family indices to populate struct with
         //  Assign index to queue families that could be found
         uint32_t queueFamilyCount = 0;
-        vkGetPhysicalDeviceQueueFamilyProperties(physicalDevice, &queueFamilyCount, nullptr);
+        vkd.vkGetPhysicalDeviceQueueFamilyProperties(physicalDevice, &queueFamilyCount, nullptr);
         
         //  Log the number of queue families
         std::cout << "The number of queue families detected are: " << queueFamilyCount << std::endl;
@@ -42,38 +46,60 @@ public:
         //  VkQueueFamilyProperties struct contains some details about the queue
         //  family, including the type of operations that are supported
         //  and the number of queues that can be created based on that family
-        std::vector<VkQueueFamilyProperties> queueFamily(queueFamilyCount);
-        vkGetPhysicalDeviceQueueFamilyProperties(physicalDevice, &queueFamilyCount, queueFamily.data());
+        //  The vector is backed by a buffer on the stack, it only falls back
+        //  to the heap if the device exposes an unusual number of families
+        std::array<std::byte, 1024> scratchBuffer;
+        std::pmr::monotonic_buffer_resource scratch(scratchBuffer.data(), scratchBuffer.size());
+        std::pmr::vector<VkQueueFamilyProperties> queueFamilies(queueFamilyCount, &scratch);
+        vkd.vkGetPhysicalDeviceQueueFamilyProperties(physicalDevice, &queueFamilyCount, queueFamilies.data());
         
-        //  find at least one queue that supports VK_QUEUE_GRAPHICS_BIT
-        int index = 0;
-        
-        //  handler to store present support
-        VkBool32 presentSupport = VK_FALSE;
-        vkGetPhysicalDeviceSurfaceSupportKHR(physicalDevice, index, surface, &presentSupport);
-        
-        //  Log the presentation support state
-        std::cout << "Does GPU support presentation on surface: " << presentSupport << std::endl;
-        
-        for (const auto& queueFamily : queueFamily) {
-            if (queueFamily.queueFlags & VK_QUEUE_GRAPHICS_BIT)
-                indices.graphicsFamily = index;
+        for (uint32_t index = 0; index < queueFamilyCount; index++) {
+            
+            bool graphicsSupport = queueFamilies[index].queueFlags & VK_QUEUE_GRAPHICS_BIT;
+            bool presentSupport = presentsToAll(physicalDevice, index, surfaces);
+            
+            //  Log the presentation support state
+            std::cout << "Queue family " << index << " presents to every surface: " << presentSupport << std::endl;
             
-            if (presentSupport) {
+            if (graphicsSupport && presentSupport) {
+                indices.graphicsFamily = index;
                 indices.presentFamily = index;
+                break;
             }
             
-            //  Break if queue family has been found
-            if (indices.isComplete()){
-                break;
+            //  Otherwise remember the first family of each kind in case none does both
+            if (graphicsSupport && !indices.graphicsFamily.has_value()) {
+                indices.graphicsFamily = index;
+            }
+            
+            if (presentSupport && !indices.presentFamily.has_value()) {
+                indices.presentFamily = index;
             }
         }
         
-        index++;
-        
         return indices;
     }
     
+private:
+    
+    //  Without surfaces (headless runs such as the benchmark) nothing is
+    //  presented, so every family qualifies and the graphics one is used
+    bool presentsToAll(VkPhysicalDevice physicalDevice, uint32_t queueFamilyIndex, const std::vector<VkSurfaceKHR>& surfaces) {
+        
+        for (VkSurfaceKHR surface : surfaces) {
+            
+            //  handler to store present support
+            VkBool32 presentSupport = VK_FALSE;
+            vkd.vkGetPhysicalDeviceSurfaceSupportKHR(physicalDevice, queueFamilyIndex, surface, &presentSupport);
+            
+            if (!presentSupport) {
+                return false;
+            }
+        }
+        
+        return true;
+    }
+    
 };
 
 #endif /* queueFamiliesHandler_h */
@@ -0,0 +1,505 @@
+#ifndef shaderHandler_h
+#define shaderHandler_h
+
+#include "frameResourcesHandler.h"
+#include <vector>
+#include <string>
+#include <fstream>
+#include <functional>
+#include <filesystem>
+#include <thread>
+#include <mutex>
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <algorithm>
+
+#ifdef __linux__
+#include <sys/inotify.h>
+#include <poll.h>
+#include <unistd.h>
+#endif
+
+class ShaderHandler {
+
+    //  Shaders are loaded from SPIR-V files compiled from GLSL sources
+    //  With hot reload on, a watcher thread notices when a source is saved,
+    //  recompiles it with a local glslc, creates the new shader module and
+    //  rebuilds every pipeline that uses it
+    //  The render thread only swaps the new pipelines in at the start of a
+    //  frame, the old ones are destroyed once no frame in flight can use them
+    //  A failed compile keeps the previous pipelines, so a typo never takes
+    //  the application down
+    //
+    //  inotify is used on Linux, other platforms fall back to polling file times
+
+public:
+
+    using ShaderId = uint32_t;
+    using PipelineId = uint32_t;
+
+    //  Compiler invoked as `<command> <source> -o <spirv>`
+    std::string compilerCommand = "glslc";
+
+    //  Builds a pipeline from the current modules of its shaders
+    //  On reload it is called from the watcher thread, so it must only
+    //  create the pipeline and not touch other render state
+    using PipelineBuilder = std::function<VkPipeline(VkDevice device, const std::vector<VkShaderModule>& modules)>;
+
+    void createShaderHandler(VkDevice device) {
+        this->device = device;
+    }
+
+    //  Loads `spirvPath`, `sourcePath` is the GLSL it is compiled from and is only needed for hot reload
+    ShaderId loadShader(const std::string& spirvPath, const std::string& sourcePath = "") {
+
+        Shader shader;
+        shader.spirvPath = spirvPath;
+        shader.sourcePath = sourcePath;
+        shader.module = createShaderModule(readFile(spirvPath));
+
+        if (!sourcePath.empty()) {
+            shader.lastWriteTime = std::filesystem::last_write_time(sourcePath);
+        }
+
+        std::lock_guard<std::mutex> lock(shaderMutex);
+        shaders.push_back(shader);
+
+        return static_cast<ShaderId>(shaders.size() - 1);
+    }
+
+    PipelineId createPipeline(const std::vector<ShaderId>& shaderIds, PipelineBuilder builder) {
+
+        std::lock_guard<std::mutex> lock(shaderMutex);
+
+        Pipeline pipeline;
+        pipeline.shaderIds = shaderIds;
+        pipeline.builder = std::move(builder);
+        pipeline.pipeline = pipeline.builder(device, modulesFor(pipeline));
+
+        pipelines.push_back(pipeline);
+
+        return static_cast<PipelineId>(pipelines.size() - 1);
+    }
+
+    //  The pipeline to bind this frame
+    VkPipeline pipeline(PipelineId id) const {
+        return pipelines[id].pipeline;
+    }
+
+    //  Starts watching the sources of every shader, including ones loaded later
+    void startHotReload() {
+
+        hotReload = true;
+        stopWatching = false;
+        watcherThread = std::thread(&ShaderHandler::watchLoop, this);
+    }
+
+    //  Call at the start of each frame, before any pipeline is bound
+    //  Swaps in pipelines rebuilt since the last frame and destroys those
+    //  replaced long enough ago that no frame in flight still uses them
+    void applyReloads() {
+
+        std::lock_guard<std::mutex> lock(shaderMutex);
+
+        for (Reload& reload : reloads) {
+            Pipeline& pipeline = pipelines[reload.pipelineId];
+            retired.push_back({ pipeline.pipeline, VK_NULL_HANDLE, frameCounter });
+            pipeline.pipeline = reload.pipeline;
+        }
+
+        reloads.clear();
+
+        for (auto& [shaderId, module] : replacedModules) {
+            retired.push_back({ VK_NULL_HANDLE, module, frameCounter });
+        }
+
+        replacedModules.clear();
+
+        for (auto it = retired.begin(); it != retired.end(); ) {
+
+            if (frameCounter >= it->retiredFrame + FrameResourcesHandler::MAX_FRAMES_IN_FLIGHT) {
+                vkd.vkDestroyPipeline(device, it->pipeline, nullptr);
+                vkd.vkDestroyShaderModule(device, it->module, nullptr);
+                it = retired.erase(it);
+            } else {
+                ++it;
+            }
+        }
+
+        frameCounter++;
+    }
+
+    //  Destroys every module and pipeline ahead of destroying a lost device
+    //  Shaders and pipelines stay registered under the same ids
+    //  Does nothing if they are already released, a recovery that failed part
+    //  way runs it again before `restoreDeviceObjects` was reached
+    void releaseDeviceObjects() {
+
+        if (device == VK_NULL_HANDLE) {
+            return;
+        }
+
+        stopHotReload();
+        destroyDeviceObjects();
+
+        device = VK_NULL_HANDLE;
+    }
+
+    //  Loads every shader again on the recreated device and rebuilds the
+    //  pipelines through their builders, which must only use objects that
+    //  were themselves recreated on `device`
+    void restoreDeviceObjects(VkDevice device) {
+
+        this->device = device;
+
+        {
+            std::lock_guard<std::mutex> lock(shaderMutex);
+
+            for (Shader& shader : shaders) {
+                shader.module = createShaderModule(readFile(shader.spirvPath));
+            }
+
+            for (Pipeline& pipeline : pipelines) {
+                pipeline.pipeline = pipeline.builder(device, modulesFor(pipeline));
+            }
+        }
+
+        if (hotReload) {
+            stopWatching = false;
+            watcherThread = std::thread(&ShaderHandler::watchLoop, this);
+        }
+    }
+
+    void cleanupShaderHandler(VkDevice device) {
+
+        this->device = device;
+
+        stopHotReload();
+        destroyDeviceObjects();
+
+        hotReload = false;
+        pipelines.clear();
+        shaders.clear();
+    }
+
+private:
+
+    void stopHotReload() {
+
+        if (watcherThread.joinable()) {
+            stopWatching = true;
+            watcherThread.join();
+        }
+    }
+
+    //  Destroys every Vulkan object, the watcher must be stopped first
+    void destroyDeviceObjects() {
+
+        //  On a lost device this returns VK_ERROR_DEVICE_LOST straight away, the objects can still be destroyed
+        vkd.vkDeviceWaitIdle(device);
+
+        for (Reload& reload : reloads) {
+            vkd.vkDestroyPipeline(device, reload.pipeline, nullptr);
+        }
+
+        for (auto& [shaderId, module] : replacedModules) {
+            vkd.vkDestroyShaderModule(device, module, nullptr);
+        }
+
+        for (Retired& entry : retired) {
+            vkd.vkDestroyPipeline(device, entry.pipeline, nullptr);
+            vkd.vkDestroyShaderModule(device, entry.module, nullptr);
+        }
+
+        for (Pipeline& pipeline : pipelines) {
+            vkd.vkDestroyPipeline(device, pipeline.pipeline, nullptr);
+            pipeline.pipeline = VK_NULL_HANDLE;
+        }
+
+        for (Shader& shader : shaders) {
+            vkd.vkDestroyShaderModule(device, shader.module, nullptr);
+            shader.module = VK_NULL_HANDLE;
+        }
+
+        reloads.clear();
+        replacedModules.clear();
+        retired.clear();
+    }
+
+    struct Shader {
+        std::string spirvPath;
+        std::string sourcePath;
+        VkShaderModule module;
+        std::filesystem::file_time_type lastWriteTime;
+    };
+
+    struct Pipeline {
+        std::vector<ShaderId> shaderIds;
+        PipelineBuilder builder;
+        VkPipeline pipeline;
+    };
+
+    //  A pipeline rebuilt on the watcher thread, waiting to be swapped in
+    struct Reload {
+        PipelineId pipelineId;
+        VkPipeline pipeline;
+    };
+
+    struct Retired {
+        VkPipeline pipeline;
+        VkShaderModule module;
+        uint64_t retiredFrame;
+    };
+
+    VkDevice device = VK_NULL_HANDLE;
+
+    //  Guards everything below, the watcher thread writes to it during a reload
+    std::mutex shaderMutex;
+    std::vector<Shader> shaders;
+    std::vector<Pipeline> pipelines;
+    std::vector<Reload> reloads;
+    std::vector<std::pair<ShaderId, VkShaderModule>> replacedModules;
+
+    std::vector<Retired> retired;
+    uint64_t frameCounter = 0;
+
+    std::thread watcherThread;
+    std::atomic<bool> stopWatching{false};
+    bool hotReload = false;
+
+    static std::vector<char> readFile(const std::string& filename) {
+
+        std::ifstream file(filename, std::ios::ate | std::ios::binary);
+
+        if (!file.is_open()) {
+            throw std::runtime_error("Failed to open " + filename);
+        }
+
+        std::vector<char> buffer(static_cast<size_t>(file.tellg()));
+        file.seekg(0);
+        file.read(buffer.data(), buffer.size());
+
+        return buffer;
+    }
+
+    VkShaderModule createShaderModule(const std::vector<char>& code) {
+
+        //  SPIR-V is a stream of 32-bit words
+        std::vector<uint32_t> words((code.size() + 3) / 4);
+        memcpy(words.data(), code.data(), code.size());
+
+        VkShaderModuleCreateInfo createInfo{};
+        createInfo.sType = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO;
+        createInfo.codeSize = code.size();
+        createInfo.pCode = words.data();
+
+        VkShaderModule shaderModule;
+
+        if (vkd.vkCreateShaderModule(device, &createInfo, nullptr, &shaderModule) != VK_SUCCESS) {
+            throw std::runtime_error("Failed to create shader module!");
+        }
+
+        return shaderModule;
+    }
+
+    std::vector<VkShaderModule> modulesFor(const Pipeline& pipeline) const {
+
+        std::vector<VkShaderModule> modules;
+
+        for (ShaderId id : pipeline.shaderIds) {
+            modules.push_back(shaders[id].module);
+        }
+
+        return modules;
+    }
+
+    //  Runs on the watcher thread
+    //  Recompiles the shader, swaps its module and rebuilds the pipelines using it
+    void reloadShader(ShaderId id) {
+
+        std::string sourcePath, spirvPath;
+
+        {
+            std::lock_guard<std::mutex> lock(shaderMutex);
+            sourcePath = shaders[id].sourcePath;
+            spirvPath = shaders[id].spirvPath;
+        }
+
+        //  The compiler writes next to `spirvPath` and the result only replaces
+        //  it once everything built from it succeeded, so a bad edit never
+        //  leaves a broken file behind for `restoreDeviceObjects` to load
+        std::string compiledPath = spirvPath + ".reload";
+        std::error_code removeError;
+        std::string command = compilerCommand + " \"" + sourcePath + "\" -o \"" + compiledPath + "\"";
+
+        auto start = std::chrono::steady_clock::now();
+
+        if (std::system(command.c_str()) != 0) {
+            std::cerr << "Shader compile failed, keeping the previous version of " << sourcePath << std::endl;
+            std::filesystem::remove(compiledPath, removeError);
+            return;
+        }
+
+        //  Pipelines are built without holding the lock, compiling them can
+        //  take long enough to stall `applyReloads` on the render thread
+        //  Only this thread replaces modules, so the copied ones stay valid
+        struct Rebuild {
+            PipelineId pipelineId;
+            PipelineBuilder builder;
+            std::vector<VkShaderModule> modules;
+        };
+
+        VkShaderModule module = VK_NULL_HANDLE;
+        std::vector<Reload> rebuilt;
+
+        try {
+            module = createShaderModule(readFile(compiledPath));
+
+            std::vector<Rebuild> rebuilds;
+
+            {
+                std::lock_guard<std::mutex> lock(shaderMutex);
+
+                for (PipelineId pipelineId = 0; pipelineId < pipelines.size(); pipelineId++) {
+                    const Pipeline& pipeline = pipelines[pipelineId];
+
+                    if (std::find(pipeline.shaderIds.begin(), pipeline.shaderIds.end(), id) == pipeline.shaderIds.end()) {
+                        continue;
+                    }
+
+                    Rebuild rebuild{ pipelineId, pipeline.builder, modulesFor(pipeline) };
+
+                    for (size_t i = 0; i < pipeline.shaderIds.size(); i++) {
+                        if (pipeline.shaderIds[i] == id) {
+                            rebuild.modules[i] = module;
+                        }
+                    }
+
+                    rebuilds.push_back(std::move(rebuild));
+                }
+            }
+
+            for (Rebuild& rebuild : rebuilds) {
+                rebuilt.push_back({ rebuild.pipelineId, rebuild.builder(device, rebuild.modules) });
+            }
+
+            std::filesystem::rename(compiledPath, spirvPath);
+        } catch (const std::exception& e) {
+            std::cerr << "Shader reload failed: " << e.what() << std::endl;
+
+            for (Reload& reload : rebuilt) {
+                vkd.vkDestroyPipeline(device, reload.pipeline, nullptr);
+            }
+
+            vkd.vkDestroyShaderModule(device, module, nullptr);
+            std::filesystem::remove(compiledPath, removeError);
+            return;
+        }
+
+        {
+            std::lock_guard<std::mutex> lock(shaderMutex);
+
+            replacedModules.push_back({ id, shaders[id].module });
+            shaders[id].module = module;
+            reloads.insert(reloads.end(), rebuilt.begin(), rebuilt.end());
+        }
+
+        auto elapsed = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+        std::cout << "Reloaded " << sourcePath << " in " << elapsed << " ms" << std::endl;
+    }
+
+    //  Shaders whose source changed on disk since it was last compiled
+    std::vector<ShaderId> changedShaders() {
+
+        std::vector<ShaderId> changed;
+        std::lock_guard<std::mutex> lock(shaderMutex);
+
+        for (ShaderId id = 0; id < shaders.size(); id++) {
+            Shader& shader = shaders[id];
+
+            std::error_code error;
+            auto writeTime = std::filesystem::last_write_time(shader.sourcePath, error);
+
+            if (shader.sourcePath.empty() || error || writeTime == shader.lastWriteTime) {
+                continue;
+            }
+
+            shader.lastWriteTime = writeTime;
+            changed.push_back(id);
+        }
+
+        return changed;
+    }
+
+#ifdef __linux__
+    //  Directories are watched rather than files, editors often save by
+    //  writing a new file and renaming it over the old one
+    void watchLoop() {
+
+        int fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+
+        if (fd < 0) {
+            std::cerr << "inotify unavailable, shader hot reload disabled" << std::endl;
+            return;
+        }
+
+        alignas(inotify_event) char events[4096];
+        size_t watchedShaders = 0;
+
+        while (!stopWatching) {
+
+            //  Shaders loaded after hot reload started get their directory watched here
+            bool newWatches = false;
+
+            {
+                std::lock_guard<std::mutex> lock(shaderMutex);
+
+                for (; watchedShaders < shaders.size(); watchedShaders++) {
+                    const Shader& shader = shaders[watchedShaders];
+
+                    if (!shader.sourcePath.empty()) {
+                        std::string directory = std::filesystem::path(shader.sourcePath).parent_path().string();
+                        inotify_add_watch(fd, directory.empty() ? "." : directory.c_str(), IN_CLOSE_WRITE | IN_MOVED_TO);
+                        newWatches = true;
+                    }
+                }
+            }
+
+            //  Wake up regularly to notice `stopWatching`
+            //  A source saved before its directory was watched raised no event,
+            //  so newly watched shaders are checked straight away
+            pollfd pollDescriptor{ fd, POLLIN, 0 };
+
+            if (!newWatches && poll(&pollDescriptor, 1, 250) <= 0) {
+                continue;
+            }
+
+            //  Drain the events, only the modification times decide what to rebuild
+            while (read(fd, events, sizeof(events)) > 0) {}
+
+            for (ShaderId id : changedShaders()) {
+                reloadShader(id);
+            }
+        }
+
+        close(fd);
+    }
+#else
+    void watchLoop() {
+
+        while (!stopWatching) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(250));
+
+            for (ShaderId id : changedShaders()) {
+                reloadShader(id);
+            }
+        }
+    }
+#endif
+
+};
+
+#endif /* shaderHandler_h */
@@ -0,0 +1,357 @@
+#ifndef simdMath_h
+#define simdMath_h
+
+#include <cstddef>
+#include <cstdint>
+
+//  The SIMD backend is chosen at compile time from the target flags
+//  AVX2 > SSE2 > NEON > scalar
+//  Defining SIMD_MATH_FORCE_SCALAR selects the scalar fallback on any target,
+//  which is what the SIMD paths are checked against
+#if defined(SIMD_MATH_FORCE_SCALAR)
+    #define SIMD_MATH_SCALAR 1
+#elif defined(__AVX2__)
+    #define SIMD_MATH_AVX2 1
+    #define SIMD_MATH_SSE 1
+    #include <immintrin.h>
+#elif defined(__SSE2__) || defined(_M_X64)
+    #define SIMD_MATH_SSE 1
+    #include <emmintrin.h>
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+    #define SIMD_MATH_NEON 1
+    #include <arm_neon.h>
+#else
+    #define SIMD_MATH_SCALAR 1
+#endif
+
+
+//  Every path evaluates the same expressions in the same order,
+//  ((a * b + c * d) + e * f) + g, with separate multiplies and adds, so the
+//  results are bit-identical to the scalar fallback
+//  This only holds if the compiler does not contract them into FMAs, clang
+//  contracts by default and arm64 always has FMA, so every build of these
+//  headers has to pass `-ffp-contract=off`, the Xcode project and the
+//  benchmark CMake both do
+namespace simdMath {
+
+    //  Column-major 4x4 matrix, the same layout GLSL expects in a uniform buffer
+    //  m[column * 4 + row]
+    struct alignas(16) Mat4 {
+        float m[16];
+
+        static Mat4 identity() {
+            Mat4 result{};
+            result.m[0] = result.m[5] = result.m[10] = result.m[15] = 1.0f;
+            return result;
+        }
+    };
+
+    //  A plane in the form `nx * x + ny * y + nz * z + d = 0`
+    //  The normal points towards the inside of the frustum
+    struct Plane {
+        float nx, ny, nz, d;
+    };
+
+    struct Frustum {
+        Plane planes[6];
+    };
+
+    //  Batches are stored as structure of arrays so a whole register
+    //  can be loaded from each component without shuffling
+    //  All arrays hold `count` elements
+    struct PointsSoA {
+        float* x;
+        float* y;
+        float* z;
+        size_t count;
+    };
+
+    struct AABBsSoA {
+        const float* minX;
+        const float* minY;
+        const float* minZ;
+        const float* maxX;
+        const float* maxY;
+        const float* maxZ;
+        size_t count;
+    };
+
+    //  Name of the backend that was compiled in, for logging
+    inline const char* backendName() {
+#if defined(SIMD_MATH_AVX2)
+        return "AVX2";
+#elif defined(SIMD_MATH_SSE)
+        return "SSE2";
+#elif defined(SIMD_MATH_NEON)
+        return "NEON";
+#else
+        return "Scalar";
+#endif
+    }
+
+
+    //  Scalar reference implementations
+    //  The SIMD paths fall back to these for the tail of a batch
+    namespace scalar {
+
+        inline void multiply(const Mat4& a, const Mat4& b, Mat4& out) {
+            Mat4 result;
+
+            for (int column = 0; column < 4; column++) {
+                const float b0 = b.m[column * 4 + 0];
+                const float b1 = b.m[column * 4 + 1];
+                const float b2 = b.m[column * 4 + 2];
+                const float b3 = b.m[column * 4 + 3];
+
+                for (int row = 0; row < 4; row++) {
+                    result.m[column * 4 + row] = ((a.m[0 + row] * b0 + a.m[4 + row] * b1) + a.m[8 + row] * b2) + a.m[12 + row] * b3;
+                }
+            }
+
+            out = result;
+        }
+
+        inline void transformPoints(const Mat4& transform, const float* inX, const float* inY, const float* inZ, PointsSoA out, size_t first) {
+            const float* m = transform.m;
+
+            for (size_t i = first; i < out.count; i++) {
+                const float x = inX[i];
+                const float y = inY[i];
+                const float z = inZ[i];
+
+                out.x[i] = ((m[0] * x + m[4] * y) + m[8] * z) + m[12];
+                out.y[i] = ((m[1] * x + m[5] * y) + m[9] * z) + m[13];
+                out.z[i] = ((m[2] * x + m[6] * y) + m[10] * z) + m[14];
+            }
+        }
+
+        inline void cullAABBs(const Frustum& frustum, const AABBsSoA& boxes, uint8_t* visible, size_t first) {
+
+            for (size_t i = first; i < boxes.count; i++) {
+                uint8_t inside = 1;
+
+                //  Test the corner that lies furthest along the plane normal,
+                //  if even that one is behind the plane the whole box is outside
+                for (const Plane& plane : frustum.planes) {
+                    const float px = plane.nx >= 0.0f ? boxes.maxX[i] : boxes.minX[i];
+                    const float py = plane.ny >= 0.0f ? boxes.maxY[i] : boxes.minY[i];
+                    const float pz = plane.nz >= 0.0f ? boxes.maxZ[i] : boxes.minZ[i];
+
+                    const float distance = ((plane.nx * px + plane.ny * py) + plane.nz * pz) + plane.d;
+
+                    if (distance < 0.0f) {
+                        inside = 0;
+                    }
+                }
+
+                visible[i] = inside;
+            }
+        }
+    }
+
+
+    //  out = a * b
+    //  `out` may alias either input
+    inline void multiply(const Mat4& a, const Mat4& b, Mat4& out) {
+#if defined(SIMD_MATH_SSE)
+        const __m128 a0 = _mm_load_ps(a.m + 0);
+        const __m128 a1 = _mm_load_ps(a.m + 4);
+        const __m128 a2 = _mm_load_ps(a.m + 8);
+        const __m128 a3 = _mm_load_ps(a.m + 12);
+
+        __m128 columns[4];
+
+        for (int column = 0; column < 4; column++) {
+            const float* bc = b.m + column * 4;
+
+            __m128 sum = _mm_add_ps(_mm_mul_ps(a0, _mm_set1_ps(bc[0])), _mm_mul_ps(a1, _mm_set1_ps(bc[1])));
+            sum = _mm_add_ps(sum, _mm_mul_ps(a2, _mm_set1_ps(bc[2])));
+            columns[column] = _mm_add_ps(sum, _mm_mul_ps(a3, _mm_set1_ps(bc[3])));
+        }
+
+        for (int column = 0; column < 4; column++) {
+            _mm_store_ps(out.m + column * 4, columns[column]);
+        }
+#elif defined(SIMD_MATH_NEON)
+        const float32x4_t a0 = vld1q_f32(a.m + 0);
+        const float32x4_t a1 = vld1q_f32(a.m + 4);
+        const float32x4_t a2 = vld1q_f32(a.m + 8);
+        const float32x4_t a3 = vld1q_f32(a.m + 12);
+
+        float32x4_t columns[4];
+
+        for (int column = 0; column < 4; column++) {
+            const float* bc = b.m + column * 4;
+
+            //  vmlaq_f32 may be emitted as a fused multiply-add on AArch64,
+            //  keep the multiply and add separate to match the scalar path
+            float32x4_t sum = vaddq_f32(vmulq_n_f32(a0, bc[0]), vmulq_n_f32(a1, bc[1]));
+            sum = vaddq_f32(sum, vmulq_n_f32(a2, bc[2]));
+            columns[column] = vaddq_f32(sum, vmulq_n_f32(a3, bc[3]));
+        }
+
+        for (int column = 0; column < 4; column++) {
+            vst1q_f32(out.m + column * 4, columns[column]);
+        }
+#else
+        scalar::multiply(a, b, out);
+#endif
+    }
+
+    //  Updates a batch of world transforms from their local transforms
+    //  out[i] = parent * locals[i]
+    inline void multiplyBatch(const Mat4& parent, const Mat4* locals, Mat4* out, size_t count) {
+        for (size_t i = 0; i < count; i++) {
+            multiply(parent, locals[i], out[i]);
+        }
+    }
+
+    //  Transforms `count` points by `transform` (w is assumed to be 1)
+    //  The output arrays may be the same as the input arrays
+    inline void transformPoints(const Mat4& transform, const float* inX, const float* inY, const float* inZ, PointsSoA out) {
+        size_t i = 0;
+
+#if defined(SIMD_MATH_AVX2)
+        const float* m = transform.m;
+        const __m256 m0 = _mm256_set1_ps(m[0]),  m1 = _mm256_set1_ps(m[1]),  m2 = _mm256_set1_ps(m[2]);
+        const __m256 m4 = _mm256_set1_ps(m[4]),  m5 = _mm256_set1_ps(m[5]),  m6 = _mm256_set1_ps(m[6]);
+        const __m256 m8 = _mm256_set1_ps(m[8]),  m9 = _mm256_set1_ps(m[9]),  m10 = _mm256_set1_ps(m[10]);
+        const __m256 m12 = _mm256_set1_ps(m[12]), m13 = _mm256_set1_ps(m[13]), m14 = _mm256_set1_ps(m[14]);
+
+        for (; i + 8 <= out.count; i += 8) {
+            const __m256 x = _mm256_loadu_ps(inX + i);
+            const __m256 y = _mm256_loadu_ps(inY + i);
+            const __m256 z = _mm256_loadu_ps(inZ + i);
+
+            const __m256 rx = _mm256_add_ps(_mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(m0, x), _mm256_mul_ps(m4, y)), _mm256_mul_ps(m8, z)), m12);
+            const __m256 ry = _mm256_add_ps(_mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(m1, x), _mm256_mul_ps(m5, y)), _mm256_mul_ps(m9, z)), m13);
+            const __m256 rz = _mm256_add_ps(_mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(m2, x), _mm256_mul_ps(m6, y)), _mm256_mul_ps(m10, z)), m14);
+
+            _mm256_storeu_ps(out.x + i, rx);
+            _mm256_storeu_ps(out.y + i, ry);
+            _mm256_storeu_ps(out.z + i, rz);
+        }
+#elif defined(SIMD_MATH_SSE)
+        const float* m = transform.m;
+        const __m128 m0 = _mm_set1_ps(m[0]),  m1 = _mm_set1_ps(m[1]),  m2 = _mm_set1_ps(m[2]);
+        const __m128 m4 = _mm_set1_ps(m[4]),  m5 = _mm_set1_ps(m[5]),  m6 = _mm_set1_ps(m[6]);
+        const __m128 m8 = _mm_set1_ps(m[8]),  m9 = _mm_set1_ps(m[9]),  m10 = _mm_set1_ps(m[10]);
+        const __m128 m12 = _mm_set1_ps(m[12]), m13 = _mm_set1_ps(m[13]), m14 = _mm_set1_ps(m[14]);
+
+        for (; i + 4 <= out.count; i += 4) {
+            const __m128 x = _mm_loadu_ps(inX + i);
+            const __m128 y = _mm_loadu_ps(inY + i);
+            const __m128 z = _mm_loadu_ps(inZ + i);
+
+            const __m128 rx = _mm_add_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(m0, x), _mm_mul_ps(m4, y)), _mm_mul_ps(m8, z)), m12);
+            const __m128 ry = _mm_add_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(m1, x), _mm_mul_ps(m5, y)), _mm_mul_ps(m9, z)), m13);
+            const __m128 rz = _mm_add_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(m2, x), _mm_mul_ps(m6, y)), _mm_mul_ps(m10, z)), m14);
+
+            _mm_storeu_ps(out.x + i, rx);
+            _mm_storeu_ps(out.y + i, ry);
+            _mm_storeu_ps(out.z + i, rz);
+        }
+#elif defined(SIMD_MATH_NEON)
+        const float* m = transform.m;
+
+        for (; i + 4 <= out.count; i += 4) {
+            const float32x4_t x = vld1q_f32(inX + i);
+            const float32x4_t y = vld1q_f32(inY + i);
+            const float32x4_t z = vld1q_f32(inZ + i);
+
+            const float32x4_t rx = vaddq_f32(vaddq_f32(vaddq_f32(vmulq_n_f32(x, m[0]), vmulq_n_f32(y, m[4])), vmulq_n_f32(z, m[8])), vdupq_n_f32(m[12]));
+            const float32x4_t ry = vaddq_f32(vaddq_f32(vaddq_f32(vmulq_n_f32(x, m[1]), vmulq_n_f32(y, m[5])), vmulq_n_f32(z, m[9])), vdupq_n_f32(m[13]));
+            const float32x4_t rz = vaddq_f32(vaddq_f32(vaddq_f32(vmulq_n_f32(x, m[2]), vmulq_n_f32(y, m[6])), vmulq_n_f32(z, m[10])), vdupq_n_f32(m[14]));
+
+            vst1q_f32(out.x + i, rx);
+            vst1q_f32(out.y + i, ry);
+            vst1q_f32(out.z + i, rz);
+        }
+#endif
+
+        scalar::transformPoints(transform, inX, inY, inZ, out, i);
+    }
+
+    //  Writes 1 to `visible[i]` if box i intersects or is inside the frustum, 0 otherwise
+    //  This is conservative, boxes near the frustum corners may be reported
+    //  visible while being outside, which is fine for culling
+    inline void cullAABBs(const Frustum& frustum, const AABBsSoA& boxes, uint8_t* visible) {
+        size_t i = 0;
+
+#if defined(SIMD_MATH_AVX2)
+        for (; i + 8 <= boxes.count; i += 8) {
+            __m256 outside = _mm256_setzero_ps();
+
+            for (const Plane& plane : frustum.planes) {
+                //  The sign of the normal is the same for every box, so the
+                //  furthest corner is picked per plane rather than per lane
+                const __m256 px = _mm256_loadu_ps((plane.nx >= 0.0f ? boxes.maxX : boxes.minX) + i);
+                const __m256 py = _mm256_loadu_ps((plane.ny >= 0.0f ? boxes.maxY : boxes.minY) + i);
+                const __m256 pz = _mm256_loadu_ps((plane.nz >= 0.0f ? boxes.maxZ : boxes.minZ) + i);
+
+                __m256 distance = _mm256_add_ps(_mm256_mul_ps(_mm256_set1_ps(plane.nx), px), _mm256_mul_ps(_mm256_set1_ps(plane.ny), py));
+                distance = _mm256_add_ps(distance, _mm256_mul_ps(_mm256_set1_ps(plane.nz), pz));
+                distance = _mm256_add_ps(distance, _mm256_set1_ps(plane.d));
+
+                outside = _mm256_or_ps(outside, _mm256_cmp_ps(distance, _mm256_setzero_ps(), _CMP_LT_OQ));
+            }
+
+            const int mask = _mm256_movemask_ps(outside);
+
+            for (int lane = 0; lane < 8; lane++) {
+                visible[i + lane] = ((mask >> lane) & 1) ? 0 : 1;
+            }
+        }
+#elif defined(SIMD_MATH_SSE)
+        for (; i + 4 <= boxes.count; i += 4) {
+            __m128 outside = _mm_setzero_ps();
+
+            for (const Plane& plane : frustum.planes) {
+                const __m128 px = _mm_loadu_ps((plane.nx >= 0.0f ? boxes.maxX : boxes.minX) + i);
+                const __m128 py = _mm_loadu_ps((plane.ny >= 0.0f ? boxes.maxY : boxes.minY) + i);
+                const __m128 pz = _mm_loadu_ps((plane.nz >= 0.0f ? boxes.maxZ : boxes.minZ) + i);
+
+                __m128 distance = _mm_add_ps(_mm_mul_ps(_mm_set1_ps(plane.nx), px), _mm_mul_ps(_mm_set1_ps(plane.ny), py));
+                distance = _mm_add_ps(distance, _mm_mul_ps(_mm_set1_ps(plane.nz), pz));
+                distance = _mm_add_ps(distance, _mm_set1_ps(plane.d));
+
+                outside = _mm_or_ps(outside, _mm_cmplt_ps(distance, _mm_setzero_ps()));
+            }
+
+            const int mask = _mm_movemask_ps(outside);
+
+            for (int lane = 0; lane < 4; lane++) {
+                visible[i + lane] = ((mask >> lane) & 1) ? 0 : 1;
+            }
+        }
+#elif defined(SIMD_MATH_NEON)
+        for (; i + 4 <= boxes.count; i += 4) {
+            uint32x4_t outside = vdupq_n_u32(0);
+
+            for (const Plane& plane : frustum.planes) {
+                const float32x4_t px = vld1q_f32((plane.nx >= 0.0f ? boxes.maxX : boxes.minX) + i);
+                const float32x4_t py = vld1q_f32((plane.ny >= 0.0f ? boxes.maxY : boxes.minY) + i);
+                const float32x4_t pz = vld1q_f32((plane.nz >= 0.0f ? boxes.maxZ : boxes.minZ) + i);
+
+                float32x4_t distance = vaddq_f32(vmulq_n_f32(px, plane.nx), vmulq_n_f32(py, plane.ny));
+                distance = vaddq_f32(distance, vmulq_n_f32(pz, plane.nz));
+                distance = vaddq_f32(distance, vdupq_n_f32(plane.d));
+
+                outside = vorrq_u32(outside, vcltq_f32(distance, vdupq_n_f32(0.0f)));
+            }
+
+            uint32_t lanes[4];
+            vst1q_u32(lanes, outside);
+
+            for (int lane = 0; lane < 4; lane++) {
+                visible[i + lane] = lanes[lane] ? 0 : 1;
+            }
+        }
+#endif
+
+        scalar::cullAABBs(frustum, boxes, visible, i);
+    }
+
+}
+
+#endif /* simdMath_h */
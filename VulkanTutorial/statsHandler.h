@@ -0,0 +1,227 @@
+#ifndef statsHandler_h
+#define statsHandler_h
+
+#include "dispatchTable.h"
+#include <array>
+#include <fstream>
+#include <iostream>
+#include <stdexcept> // To report and propagate errors
+#include <string>
+
+class StatsHandler {
+
+    //  Turns the running counters in `frameStats` into a snapshot per frame:
+    //  memory usage and budget of every heap, objects alive by type, and the
+    //  memory allocations, submits and draws made since the previous frame
+    //  The latest snapshot is kept in `stats`, and with an export file open
+    //  every snapshot is appended to it as one line of JSON
+    //
+    //  Heap usage and budget come from VK_EXT_memory_budget when the device
+    //  was created with it, which includes memory held by other processes and
+    //  the driver itself
+    //  Without it usage is what was allocated through `vkd` and the budget is
+    //  the size of the heap
+
+public:
+
+    struct HeapStats {
+        VkDeviceSize size;
+        VkDeviceSize budget;
+        VkDeviceSize usage;
+    };
+
+    struct FrameStats {
+        uint64_t frame = 0;
+
+        uint32_t heapCount = 0;
+        std::array<HeapStats, VK_MAX_MEMORY_HEAPS> heaps{};
+
+        //  True when `heaps` was filled in by the driver through VK_EXT_memory_budget
+        bool driverBudget = false;
+
+        std::array<int64_t, frameStats::OBJECT_TYPE_COUNT> liveObjects{};
+
+        //  Made during this frame
+        uint64_t memoryAllocations = 0;
+        uint64_t submits = 0;
+        uint64_t draws = 0;
+    };
+
+    //  The snapshot taken by the last `collectFrame`
+    FrameStats stats;
+
+    //  Again whenever the device is recreated, the physical device may have changed
+    //  `memoryBudgetEnabled` when the logical device was created with VK_EXT_memory_budget
+    void setupStats(VkPhysicalDevice physicalDevice, bool memoryBudgetEnabled) {
+
+        this->physicalDevice = physicalDevice;
+        this->memoryBudgetEnabled = memoryBudgetEnabled && vkd.vkGetPhysicalDeviceMemoryProperties2KHR != nullptr;
+
+        vkd.vkGetPhysicalDeviceMemoryProperties(physicalDevice, &memoryProperties);
+
+        overBudget.fill(false);
+    }
+
+    //  Appends a line of JSON per frame to `path`, replacing whatever was there
+    void openExport(const std::string& path) {
+
+        exportFile.open(path, std::ios::out | std::ios::trunc);
+
+        if (!exportFile.is_open()) {
+            throw std::runtime_error("Failed to open stats file " + path + "!");
+        }
+    }
+
+    //  Call once per frame, after its submit
+    const FrameStats& collectFrame() {
+
+        stats.frame = frameIndex++;
+
+        collectHeaps();
+
+        for (size_t i = 0; i < frameStats::OBJECT_TYPE_COUNT; i++) {
+            stats.liveObjects[i] = frameStats::liveObjects[i].load(std::memory_order_relaxed);
+        }
+
+        uint64_t memoryAllocations = frameStats::memoryAllocations.load(std::memory_order_relaxed);
+        uint64_t submits = frameStats::submits;
+        uint64_t draws = frameStats::draws;
+
+        stats.memoryAllocations = memoryAllocations - lastMemoryAllocations;
+        stats.submits = submits - lastSubmits;
+        stats.draws = draws - lastDraws;
+
+        lastMemoryAllocations = memoryAllocations;
+        lastSubmits = submits;
+        lastDraws = draws;
+
+        reportBudgetOverruns();
+
+        if (exportFile.is_open()) {
+            writeStats();
+        }
+
+        return stats;
+    }
+
+    //  Call after every object has been destroyed, anything still alive was leaked
+    //  Returns true when nothing was
+    bool reportLeaks() {
+
+        bool clean = true;
+
+        for (size_t i = 0; i < frameStats::OBJECT_TYPE_COUNT; i++) {
+
+            int64_t live = frameStats::liveObjects[i].load(std::memory_order_relaxed);
+
+            if (live != 0) {
+                std::cerr << "Leaked " << live << " " << frameStats::objectTypeName(static_cast<frameStats::ObjectType>(i)) << " objects" << std::endl;
+                clean = false;
+            }
+        }
+
+        return clean;
+    }
+
+    void cleanupStats() {
+
+        if (exportFile.is_open()) {
+            exportFile.close();
+        }
+    }
+
+private:
+
+    VkPhysicalDevice physicalDevice = VK_NULL_HANDLE;
+    bool memoryBudgetEnabled = false;
+    VkPhysicalDeviceMemoryProperties memoryProperties{};
+
+    uint64_t frameIndex = 0;
+    uint64_t lastMemoryAllocations = 0;
+    uint64_t lastSubmits = 0;
+    uint64_t lastDraws = 0;
+
+    //  Overruns are reported when a heap goes over budget, not on every frame it stays there
+    std::array<bool, VK_MAX_MEMORY_HEAPS> overBudget{};
+
+    std::ofstream exportFile;
+
+    void collectHeaps() {
+
+        stats.heapCount = memoryProperties.memoryHeapCount;
+        stats.driverBudget = memoryBudgetEnabled;
+
+        if (memoryBudgetEnabled) {
+
+            //  Chained to the properties query, filled in by the driver on every call
+            VkPhysicalDeviceMemoryBudgetPropertiesEXT budgetProperties{};
+            budgetProperties.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_MEMORY_BUDGET_PROPERTIES_EXT;
+
+            VkPhysicalDeviceMemoryProperties2 properties{};
+            properties.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_MEMORY_PROPERTIES_2;
+            properties.pNext = &budgetProperties;
+
+            vkd.vkGetPhysicalDeviceMemoryProperties2KHR(physicalDevice, &properties);
+
+            for (uint32_t i = 0; i < stats.heapCount; i++) {
+                stats.heaps[i] = { memoryProperties.memoryHeaps[i].size, budgetProperties.heapBudget[i], budgetProperties.heapUsage[i] };
+            }
+
+            return;
+        }
+
+        for (uint32_t i = 0; i < stats.heapCount; i++) {
+            stats.heaps[i] = { memoryProperties.memoryHeaps[i].size, memoryProperties.memoryHeaps[i].size, 0 };
+        }
+
+        for (uint32_t i = 0; i < memoryProperties.memoryTypeCount; i++) {
+            stats.heaps[memoryProperties.memoryTypes[i].heapIndex].usage += frameStats::allocatedBytes[i].load(std::memory_order_relaxed);
+        }
+    }
+
+    void reportBudgetOverruns() {
+
+        for (uint32_t i = 0; i < stats.heapCount; i++) {
+
+            bool over = stats.heaps[i].usage > stats.heaps[i].budget;
+
+            if (over && !overBudget[i]) {
+                std::cerr << "Frame " << stats.frame << ": memory heap " << i << " is over budget, " << stats.heaps[i].usage << " of " << stats.heaps[i].budget << " bytes used" << std::endl;
+            }
+
+            overBudget[i] = over;
+        }
+    }
+
+    //  {"frame":12,"memoryAllocations":0,"submits":1,"draws":0,"driverBudget":true,
+    //   "heaps":[{"size":...,"budget":...,"usage":...}],"objects":{"Buffer":3,...}}
+    //  No flush, the stream writes out whenever its buffer fills
+    void writeStats() {
+
+        exportFile << "{\"frame\":" << stats.frame
+                   << ",\"memoryAllocations\":" << stats.memoryAllocations
+                   << ",\"submits\":" << stats.submits
+                   << ",\"draws\":" << stats.draws
+                   << ",\"driverBudget\":" << (stats.driverBudget ? "true" : "false")
+                   << ",\"heaps\":[";
+
+        for (uint32_t i = 0; i < stats.heapCount; i++) {
+            exportFile << (i > 0 ? "," : "")
+                       << "{\"size\":" << stats.heaps[i].size
+                       << ",\"budget\":" << stats.heaps[i].budget
+                       << ",\"usage\":" << stats.heaps[i].usage << "}";
+        }
+
+        exportFile << "],\"objects\":{";
+
+        for (size_t i = 0; i < frameStats::OBJECT_TYPE_COUNT; i++) {
+            exportFile << (i > 0 ? "," : "")
+                       << "\"" << frameStats::objectTypeName(static_cast<frameStats::ObjectType>(i)) << "\":" << stats.liveObjects[i];
+        }
+
+        exportFile << "}}\n";
+    }
+
+};
+
+#endif /* statsHandler_h */
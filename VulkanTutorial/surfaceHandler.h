@@ -1,10 +1,10 @@
 #ifndef surfaceHandler_h
 #define surfaceHandler_h
 
-#define GLFW_INCLUDE_VULKAN
-#include <GLFW/glfw3.h>
+#include "dispatchTable.h"
 #include <iostream>   // To report and propagate errors
 #include <stdexcept> // To report and propagate errors
+#include <vector>
 
 class SurfaceHandler {
     
@@ -13,19 +13,49 @@ class SurfaceHandler {
     //  WSI extensions such as VkSurfaceKHR are needed to establish
     //  connection between Vulkan and the window system to present
     //  results to the screen
+    //  One surface per window, every window the application drives has one
     
 public:
-    VkSurfaceKHR surface;
+    std::vector<VkSurfaceKHR> surfaces;
     
     
-    void createSurface(VkInstance instance, GLFWwindow* window) {
+    //  Returns the index of the new surface in `surfaces`
+    size_t createSurface(VkInstance instance, GLFWwindow* window) {
         
         //  the glfwCreateWindowSurface function performs the surface creation very well 
         //  with different implementation for each platform
+        VkSurfaceKHR surface;
         
         if (glfwCreateWindowSurface(instance, window, nullptr, &surface) != VK_SUCCESS) {
             throw std::runtime_error("Failed to create window surface!");
         }
+        
+        surfaces.push_back(surface);
+        
+        return surfaces.size() - 1;
+    }
+    
+    void destroySurfaces(VkInstance instance) {
+        
+        for (VkSurfaceKHR surface : surfaces) {
+            vkd.vkDestroySurfaceKHR(instance, surface, nullptr);
+        }
+        
+        surfaces.clear();
+    }
+    
+    //  After VK_ERROR_SURFACE_LOST_KHR the surface is unusable, but the window
+    //  it came from is still there, so a new one can be created from it
+    //  The error does not say which surface was lost, so all of them are
+    //  created again from `windows`, in the same order
+    //  Everything created against the old surfaces must be destroyed first
+    void recreateSurfaces(VkInstance instance, const std::vector<GLFWwindow*>& windows) {
+        
+        destroySurfaces(instance);
+        
+        for (GLFWwindow* window : windows) {
+            createSurface(instance, window);
+        }
     }
     
 };
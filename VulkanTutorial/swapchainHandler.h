@@ -0,0 +1,315 @@
+#ifndef swapchainHandler_h
+#define swapchainHandler_h
+
+#include "frameResourcesHandler.h"
+#include "queueFamiliesHandler.h"
+#include "vulkanErrors.h"
+#include <vector>
+#include <array>
+#include <algorithm>
+
+class SwapchainHandler {
+
+    //  A swapchain is a queue of images owned by the presentation engine
+    //  An image is acquired, rendered to, and handed back to be shown on the
+    //  surface it was created for
+    //  One SwapchainHandler drives one surface, several of them can share a
+    //  logical device as long as its present queue supports all their surfaces
+    //
+    //  Acquire semaphores are per frame in flight, the frame's fence guards
+    //  their reuse
+    //  Render finished semaphores are per image, the presentation engine may
+    //  still hold one after the frame's fence has signalled, but not after
+    //  the same image has been acquired again
+    //
+    //  A replaced swapchain is retired together with its views and semaphores,
+    //  and destroyed once every frame that was in flight when it was replaced
+    //  has had its fence waited on
+
+public:
+
+    VkSwapchainKHR swapchain = VK_NULL_HANDLE;
+    VkFormat imageFormat;
+    VkExtent2D extent{};
+
+    std::vector<VkImage> images;
+    std::vector<VkImageView> imageViews;
+
+    std::array<VkSemaphore, FrameResourcesHandler::MAX_FRAMES_IN_FLIGHT> imageAvailableSemaphores{};
+    std::vector<VkSemaphore> renderFinishedSemaphores;
+
+    //  Creates the swapchain, or does nothing while the window is minimized,
+    //  in which case `swapchain` stays VK_NULL_HANDLE and creation is tried again later
+    //  `oldSwapchain` is the one being replaced, if any, it stays valid for presents already queued
+    void createSwapchain(VkPhysicalDevice physicalDevice, VkDevice device, VkSurfaceKHR surface, GLFWwindow* window, const QueueFamiliesHandler::QueueFamilyIndices& indices, VkSwapchainKHR oldSwapchain = VK_NULL_HANDLE) {
+
+        VkSurfaceCapabilitiesKHR capabilities;
+        checkResult(vkd.vkGetPhysicalDeviceSurfaceCapabilitiesKHR(physicalDevice, surface, &capabilities), "Failed to query surface capabilities!");
+
+        extent = chooseExtent(capabilities, window);
+
+        if (extent.width == 0 || extent.height == 0) {
+            return;
+        }
+
+        VkSurfaceFormatKHR surfaceFormat = chooseSurfaceFormat(physicalDevice, surface);
+        imageFormat = surfaceFormat.format;
+
+        //  One more than the minimum, so acquiring never has to wait for the driver
+        uint32_t imageCount = capabilities.minImageCount + 1;
+
+        if (capabilities.maxImageCount > 0) {
+            imageCount = std::min(imageCount, capabilities.maxImageCount);
+        }
+
+        VkSwapchainCreateInfoKHR createInfo{};
+        createInfo.sType = VK_STRUCTURE_TYPE_SWAPCHAIN_CREATE_INFO_KHR;
+        createInfo.surface = surface;
+        createInfo.minImageCount = imageCount;
+        createInfo.imageFormat = surfaceFormat.format;
+        createInfo.imageColorSpace = surfaceFormat.colorSpace;
+        createInfo.imageExtent = extent;
+        createInfo.imageArrayLayers = 1;
+
+        //  TRANSFER_DST so the images can be cleared before anything draws into them
+        createInfo.imageUsage = VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | (capabilities.supportedUsageFlags & VK_IMAGE_USAGE_TRANSFER_DST_BIT);
+
+        //  When rendering and presentation happen on different queue families
+        //  the images are shared between them instead of transferring ownership every frame
+        uint32_t queueFamilyIndices[] = { indices.graphicsFamily.value(), indices.presentFamily.value() };
+
+        if (indices.graphicsFamily != indices.presentFamily) {
+            createInfo.imageSharingMode = VK_SHARING_MODE_CONCURRENT;
+            createInfo.queueFamilyIndexCount = 2;
+            createInfo.pQueueFamilyIndices = queueFamilyIndices;
+        } else {
+            createInfo.imageSharingMode = VK_SHARING_MODE_EXCLUSIVE;
+        }
+
+        createInfo.preTransform = capabilities.currentTransform;
+        createInfo.compositeAlpha = VK_COMPOSITE_ALPHA_OPAQUE_BIT_KHR;
+        createInfo.presentMode = choosePresentMode(physicalDevice, surface);
+        createInfo.clipped = VK_TRUE;
+        createInfo.oldSwapchain = oldSwapchain;
+
+        checkResult(vkd.vkCreateSwapchainKHR(device, &createInfo, nullptr, &swapchain), "Failed to create swapchain!");
+
+        uint32_t swapchainImageCount = 0;
+        vkd.vkGetSwapchainImagesKHR(device, swapchain, &swapchainImageCount, nullptr);
+
+        images.resize(swapchainImageCount);
+        vkd.vkGetSwapchainImagesKHR(device, swapchain, &swapchainImageCount, images.data());
+
+        supportsTransferDst = (createInfo.imageUsage & VK_IMAGE_USAGE_TRANSFER_DST_BIT) != 0;
+
+        for (VkImage image : images) {
+            imageViews.push_back(createImageView(device, image));
+            renderFinishedSemaphores.push_back(createSemaphore(device));
+        }
+
+        for (VkSemaphore& semaphore : imageAvailableSemaphores) {
+            semaphore = createSemaphore(device);
+        }
+    }
+
+    //  After VK_ERROR_OUT_OF_DATE_KHR or VK_SUBOPTIMAL_KHR, usually a resize,
+    //  or to retry a swapchain that could not be created while minimized
+    //  The old swapchain is retired instead of destroyed, frames still in flight may use its images,
+    //  and waiting for the device here would stall every other output as well
+    //  Call before acquiring for the frame, its acquire semaphore is not in use then
+    void recreateSwapchain(VkPhysicalDevice physicalDevice, VkDevice device, VkSurfaceKHR surface, GLFWwindow* window, const QueueFamiliesHandler::QueueFamilyIndices& indices) {
+
+        VkSwapchainKHR oldSwapchain = swapchain;
+
+        if (oldSwapchain != VK_NULL_HANDLE) {
+            retireSwapchain();
+        }
+
+        createSwapchain(physicalDevice, device, surface, window, indices, oldSwapchain);
+    }
+
+    //  Call once per frame, after `FrameResourcesHandler::beginFrame` has waited on the frame's fence
+    //  A swapchain retired MAX_FRAMES_IN_FLIGHT frames ago is no longer used by any frame's commands
+    //  The presentation engine is left the same margin for the presents that waited on its semaphores
+    void releaseRetired(VkDevice device) {
+
+        for (auto it = retired.begin(); it != retired.end();) {
+
+            if (--it->framesLeft == 0) {
+                destroyRetired(device, *it);
+                it = retired.erase(it);
+            } else {
+                ++it;
+            }
+        }
+    }
+
+    //  Returns VK_SUCCESS, VK_SUBOPTIMAL_KHR or VK_ERROR_OUT_OF_DATE_KHR, other errors throw
+    //  The image may only be written after `imageAvailableSemaphores[frameIndex]` has signalled
+    VkResult acquireNextImage(VkDevice device, uint32_t frameIndex, uint32_t& imageIndex) {
+
+        VkResult result = vkd.vkAcquireNextImageKHR(device, swapchain, UINT64_MAX, imageAvailableSemaphores[frameIndex], VK_NULL_HANDLE, &imageIndex);
+
+        if (result != VK_SUBOPTIMAL_KHR && result != VK_ERROR_OUT_OF_DATE_KHR) {
+            checkResult(result, "Failed to acquire swapchain image!");
+        }
+
+        return result;
+    }
+
+    bool canClear() const {
+        return supportsTransferDst;
+    }
+
+    //  Only after the device is idle, destroys the retired swapchains too
+    void cleanupSwapchain(VkDevice device) {
+
+        if (swapchain != VK_NULL_HANDLE) {
+            retireSwapchain();
+        }
+
+        for (Retired& old : retired) {
+            destroyRetired(device, old);
+        }
+
+        retired.clear();
+    }
+
+private:
+
+    bool supportsTransferDst = false;
+
+    //  A replaced swapchain with everything that was created for it
+    struct Retired {
+        VkSwapchainKHR swapchain;
+        std::vector<VkImageView> imageViews;
+        std::vector<VkSemaphore> renderFinishedSemaphores;
+        std::array<VkSemaphore, FrameResourcesHandler::MAX_FRAMES_IN_FLIGHT> imageAvailableSemaphores;
+
+        //  Frames to go before it is destroyed
+        uint32_t framesLeft;
+    };
+
+    std::vector<Retired> retired;
+
+    //  Moves the current swapchain to `retired` and leaves the handler empty
+    void retireSwapchain() {
+
+        retired.push_back({ swapchain, std::move(imageViews), std::move(renderFinishedSemaphores), imageAvailableSemaphores, FrameResourcesHandler::MAX_FRAMES_IN_FLIGHT });
+
+        swapchain = VK_NULL_HANDLE;
+        images.clear();
+        imageViews.clear();
+        renderFinishedSemaphores.clear();
+        imageAvailableSemaphores.fill(VK_NULL_HANDLE);
+    }
+
+    void destroyRetired(VkDevice device, Retired& old) {
+
+        for (VkImageView imageView : old.imageViews) {
+            vkd.vkDestroyImageView(device, imageView, nullptr);
+        }
+
+        for (VkSemaphore semaphore : old.renderFinishedSemaphores) {
+            vkd.vkDestroySemaphore(device, semaphore, nullptr);
+        }
+
+        for (VkSemaphore semaphore : old.imageAvailableSemaphores) {
+            vkd.vkDestroySemaphore(device, semaphore, nullptr);
+        }
+
+        //  The images belong to the swapchain and go with it
+        vkd.vkDestroySwapchainKHR(device, old.swapchain, nullptr);
+    }
+
+    //  8 bit sRGB where available, otherwise whatever the surface lists first
+    VkSurfaceFormatKHR chooseSurfaceFormat(VkPhysicalDevice physicalDevice, VkSurfaceKHR surface) {
+
+        uint32_t formatCount = 0;
+        vkd.vkGetPhysicalDeviceSurfaceFormatsKHR(physicalDevice, surface, &formatCount, nullptr);
+
+        std::vector<VkSurfaceFormatKHR> formats(formatCount);
+        vkd.vkGetPhysicalDeviceSurfaceFormatsKHR(physicalDevice, surface, &formatCount, formats.data());
+
+        if (formats.empty()) {
+            throw std::runtime_error("Surface has no formats!");
+        }
+
+        for (const VkSurfaceFormatKHR& format : formats) {
+            if (format.format == VK_FORMAT_B8G8R8A8_SRGB && format.colorSpace == VK_COLOR_SPACE_SRGB_NONLINEAR_KHR) {
+                return format;
+            }
+        }
+
+        return formats[0];
+    }
+
+    //  MAILBOX never blocks the batched present on one slow window,
+    //  FIFO is the only mode every implementation has to support
+    VkPresentModeKHR choosePresentMode(VkPhysicalDevice physicalDevice, VkSurfaceKHR surface) {
+
+        uint32_t presentModeCount = 0;
+        vkd.vkGetPhysicalDeviceSurfacePresentModesKHR(physicalDevice, surface, &presentModeCount, nullptr);
+
+        std::vector<VkPresentModeKHR> presentModes(presentModeCount);
+        vkd.vkGetPhysicalDeviceSurfacePresentModesKHR(physicalDevice, surface, &presentModeCount, presentModes.data());
+
+        if (std::find(presentModes.begin(), presentModes.end(), VK_PRESENT_MODE_MAILBOX_KHR) != presentModes.end()) {
+            return VK_PRESENT_MODE_MAILBOX_KHR;
+        }
+
+        return VK_PRESENT_MODE_FIFO_KHR;
+    }
+
+    //  The surface either dictates the extent, or leaves it to the window's framebuffer size
+    VkExtent2D chooseExtent(const VkSurfaceCapabilitiesKHR& capabilities, GLFWwindow* window) {
+
+        if (capabilities.currentExtent.width != UINT32_MAX) {
+            return capabilities.currentExtent;
+        }
+
+        int width, height;
+        glfwGetFramebufferSize(window, &width, &height);
+
+        VkExtent2D actualExtent = { static_cast<uint32_t>(width), static_cast<uint32_t>(height) };
+        actualExtent.width = std::clamp(actualExtent.width, capabilities.minImageExtent.width, capabilities.maxImageExtent.width);
+        actualExtent.height = std::clamp(actualExtent.height, capabilities.minImageExtent.height, capabilities.maxImageExtent.height);
+
+        return actualExtent;
+    }
+
+    VkImageView createImageView(VkDevice device, VkImage image) {
+
+        VkImageViewCreateInfo viewInfo{};
+        viewInfo.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
+        viewInfo.image = image;
+        viewInfo.viewType = VK_IMAGE_VIEW_TYPE_2D;
+        viewInfo.format = imageFormat;
+        viewInfo.subresourceRange = { VK_IMAGE_ASPECT_COLOR_BIT, 0, 1, 0, 1 };
+
+        VkImageView imageView;
+
+        if (vkd.vkCreateImageView(device, &viewInfo, nullptr, &imageView) != VK_SUCCESS) {
+            throw std::runtime_error("Failed to create swapchain image view!");
+        }
+
+        return imageView;
+    }
+
+    VkSemaphore createSemaphore(VkDevice device) {
+
+        VkSemaphoreCreateInfo semaphoreInfo{};
+        semaphoreInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
+
+        VkSemaphore semaphore;
+
+        if (vkd.vkCreateSemaphore(device, &semaphoreInfo, nullptr, &semaphore) != VK_SUCCESS) {
+            throw std::runtime_error("Failed to create swapchain semaphore!");
+        }
+
+        return semaphore;
+    }
+
+};
+
+#endif /* swapchainHandler_h */
@@ -0,0 +1,931 @@
+#ifndef textureStreamingHandler_h
+#define textureStreamingHandler_h
+
+#include "bufferHandler.h"
+#include "frameResourcesHandler.h"
+#include <vector>
+#include <deque>
+#include <list>
+#include <map>
+#include <functional>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <iostream>
+#include <string>
+
+class TextureStreamingHandler {
+
+    //  Textures are only kept resident down to the mip level their on-screen
+    //  size needs
+    //  The resident levels of a texture always form a contiguous tail of the
+    //  chain, [residentMip .. mipLevels - 1], held in one VkImage
+    //  Streaming in a larger level (or evicting one) creates a new image for
+    //  the new range, copies the levels both share on the GPU, uploads the
+    //  new levels from a staging buffer and retires the old image once the
+    //  frames that may still sample it have finished
+    //
+    //  Mip data is read on a worker thread, the render thread only memcpys
+    //  finished levels into the staging buffer and records the copies
+    //
+    //  When the resident set would exceed the budget, levels are dropped from
+    //  the least recently used textures first, the smallest level of every
+    //  texture is never evicted so there is always something to sample
+    //
+    //  Uploaded levels are also kept in a host side shadow, so after a device
+    //  loss the resident set can be uploaded again straight from memory
+    //  instead of being read and transcoded from disk
+
+public:
+
+    using TextureId = uint32_t;
+
+    //  Fraction of the largest device local heap used when no explicit budget is given
+    static constexpr double DEFAULT_BUDGET_FRACTION = 0.5;
+
+    //  Size of each frame's slice of the staging buffer
+    static constexpr VkDeviceSize STAGING_SIZE = 16 * 1024 * 1024;
+
+    //  Keep a host copy of every resident level for device loss recovery
+    //  Costs as much system memory as the resident set uses on the GPU,
+    //  without it recovery reloads the levels through `loadMip`
+    bool keepHostShadow = true;
+
+    struct TextureSource {
+        uint32_t width;
+        uint32_t height;
+        uint32_t mipLevels;
+        VkFormat format;
+
+        //  Returns the texels of one mip level, tightly packed
+        //  Called on the streaming thread, so it must not touch render state
+        //  Throwing marks the texture as failed, see `hasFailed`
+        std::function<std::vector<uint8_t>(uint32_t mipLevel)> loadMip;
+    };
+
+    struct Texture {
+        TextureSource source;
+
+        VkImage image = VK_NULL_HANDLE;
+        VkDeviceMemory memory = VK_NULL_HANDLE;
+        VkImageView view = VK_NULL_HANDLE;
+
+        //  First resident level, `mipLevels` while nothing is resident yet
+        uint32_t residentMip;
+
+        //  Finest level asked for from the streaming thread
+        uint32_t requestedMip;
+
+        //  Finest level the current on-screen size needs
+        uint32_t desiredMip;
+
+        //  Set by eviction, applied in the next `update`
+        uint32_t targetMip;
+
+        uint64_t lastUsedFrame = 0;
+        std::list<TextureId>::iterator lruPosition;
+
+        //  A level could not be loaded, nothing finer is requested for the
+        //  texture, the coarser levels stay usable
+        bool failed = false;
+
+        //  Levels read by the streaming thread, waiting for upload
+        std::map<uint32_t, std::vector<uint8_t>> loadedMips;
+
+        //  Host copies of the resident levels, only filled with `keepHostShadow`
+        std::map<uint32_t, std::vector<uint8_t>> shadowMips;
+    };
+
+    void createTextureStreaming(VkPhysicalDevice physicalDevice, VkDevice device, VkDeviceSize budgetOverride = 0) {
+
+        this->budgetOverride = budgetOverride;
+
+        createDeviceResources(physicalDevice, device);
+
+        stopStreaming = false;
+        streamingThread = std::thread(&TextureStreamingHandler::streamingLoop, this);
+
+        std::cout << "Texture streaming budget: " << budget / (1024 * 1024) << " MB" << std::endl;
+    }
+
+    //  Registers a texture, only its smallest level is requested straight away
+    TextureId registerTexture(TextureSource source) {
+
+        if (!isKnownFormat(source.format)) {
+            throw std::runtime_error("Texture format is not supported by the streamer!");
+        }
+
+        if (source.width == 0 || source.height == 0 || source.mipLevels == 0 || source.mipLevels > fullMipChainLength(source.width, source.height)) {
+            throw std::runtime_error("Texture has no levels or more than its size allows!");
+        }
+
+        if (mipByteSize(source.format, source.width, source.height) > STAGING_SIZE) {
+            throw std::runtime_error("Texture level 0 does not fit in the streaming staging buffer!");
+        }
+
+        TextureId id = static_cast<TextureId>(textures.size());
+
+        Texture texture;
+        texture.source = std::move(source);
+        texture.residentMip = texture.source.mipLevels;
+        texture.requestedMip = texture.source.mipLevels;
+        texture.desiredMip = texture.source.mipLevels - 1;
+        texture.targetMip = texture.residentMip;
+        texture.lastUsedFrame = frameCounter;
+        texture.lruPosition = lru.insert(lru.end(), id);
+
+        textures.push_back(std::move(texture));
+
+        return id;
+    }
+
+    //  Marks the texture as used this frame and records the finest level
+    //  needed to draw it at `screenSize` pixels along its longest side
+    void requestMip(TextureId id, float screenSize) {
+
+        Texture& texture = textures[id];
+
+        float texels = static_cast<float>(std::max(texture.source.width, texture.source.height));
+        float level = std::floor(std::log2(texels / std::max(screenSize, 1.0f)));
+
+        uint32_t mip = static_cast<uint32_t>(std::clamp(level, 0.0f, static_cast<float>(texture.source.mipLevels - 1)));
+
+        //  Several draws may use the texture in one frame, keep the finest
+        if (texture.lastUsedFrame != frameCounter || mip < texture.desiredMip) {
+            texture.desiredMip = mip;
+        }
+
+        texture.lastUsedFrame = frameCounter;
+        lru.splice(lru.end(), lru, texture.lruPosition);
+    }
+
+    //  Call once per frame after `FrameResourcesHandler::beginFrame` and the
+    //  frame's `requestMip` calls, with a command buffer that is submitted before any draw sampling the textures
+    //  `frameIndex` selects the staging slice, its previous uploads are known
+    //  to be finished because the frame's fence has been waited on
+    void update(VkCommandBuffer commandBuffer, uint32_t frameIndex) {
+
+        destroyRetiredImages();
+        collectLoadedMips();
+        requestLoads();
+
+        stagingOffset = 0;
+        stagingBase = frameIndex * STAGING_SIZE;
+
+        for (TextureId id = 0; id < textures.size(); id++) {
+            Texture& texture = textures[id];
+
+            //  Eviction decided on a coarser range
+            if (texture.targetMip > texture.residentMip) {
+                reallocate(commandBuffer, texture, texture.targetMip);
+                continue;
+            }
+
+            //  Upload the loaded levels that extend the resident chain, as many
+            //  as fit in what is left of this frame's staging slice
+            //  The rest go in the following frames, which matters when a
+            //  whole chain comes back at once after a device loss
+            uint32_t newResidentMip = texture.residentMip;
+            VkDeviceSize stagingBytes = 0;
+
+            while (newResidentMip > 0 && texture.loadedMips.count(newResidentMip - 1)) {
+
+                VkDeviceSize bytes = stagingLevelBytes(texture, newResidentMip - 1);
+
+                if (stagingOffset + stagingBytes + bytes > STAGING_SIZE) {
+                    break;
+                }
+
+                stagingBytes += bytes;
+                newResidentMip--;
+            }
+
+            if (newResidentMip < texture.residentMip) {
+                reallocate(commandBuffer, texture, newResidentMip);
+            }
+        }
+
+        frameCounter++;
+    }
+
+    bool isResident(TextureId id) const {
+        return textures[id].view != VK_NULL_HANDLE;
+    }
+
+    bool hasFailed(TextureId id) const {
+        return textures[id].failed;
+    }
+
+    //  Finest level the image holds, `mipLevels` while nothing is resident
+    uint32_t residentMip(TextureId id) const {
+        return textures[id].residentMip;
+    }
+
+    //  View over every resident level, VK_NULL_HANDLE until the first level has arrived
+    //  The view changes whenever the resident range does, so descriptors
+    //  should be written from it every frame
+    VkImageView imageView(TextureId id) const {
+        return textures[id].view;
+    }
+
+    VkDeviceSize budgetBytes() const { return budget; }
+    VkDeviceSize residentBytesTotal() const { return residentBytes; }
+
+    //  Destroys every image and the staging buffer ahead of destroying a lost device
+    //  Textures stay registered, the levels they had resident are queued for
+    //  upload again, from the host shadow when there is one
+    //  The streaming thread keeps running, it never touches the device
+    //  Does nothing if they are already released, a recovery that failed part
+    //  way runs it again before `restoreDeviceResources` was reached
+    void releaseDeviceResources() {
+
+        if (device == VK_NULL_HANDLE) {
+            return;
+        }
+
+        vkd.vkDeviceWaitIdle(device);
+
+        for (RetiredImage& retired : retiredImages) {
+            destroyImage(retired.image, retired.memory, retired.view);
+        }
+
+        retiredImages.clear();
+
+        for (Texture& texture : textures) {
+
+            if (texture.image != VK_NULL_HANDLE) {
+                destroyImage(texture.image, texture.memory, texture.view);
+            }
+
+            texture.image = VK_NULL_HANDLE;
+            texture.memory = VK_NULL_HANDLE;
+            texture.view = VK_NULL_HANDLE;
+
+            uint32_t mipLevels = texture.source.mipLevels;
+
+            //  Levels planned for eviction were already taken off `residentBytes`
+            uint32_t firstResident = std::max(texture.residentMip, texture.targetMip);
+
+            bool shadowed = keepHostShadow && firstResident < mipLevels;
+
+            for (uint32_t mip = firstResident; mip < mipLevels && shadowed; mip++) {
+                shadowed = texture.shadowMips.count(mip) != 0;
+            }
+
+            if (shadowed) {
+
+                //  The levels become loaded but not uploaded, `update` picks them up again
+                for (uint32_t mip = firstResident; mip < mipLevels; mip++) {
+                    pendingBytes += levelBytes(texture, mip);
+                    texture.loadedMips[mip] = std::move(texture.shadowMips[mip]);
+                }
+
+                texture.residentMip = mipLevels;
+                texture.targetMip = mipLevels;
+            } else {
+                //  Start over as if the texture was just registered, but
+                //  still wanting the levels it had
+                dropPlannedLevels(texture);
+
+                texture.residentMip = mipLevels;
+                texture.targetMip = mipLevels;
+                texture.requestedMip = mipLevels;
+                texture.desiredMip = std::min(texture.desiredMip, std::min(firstResident, mipLevels - 1));
+                texture.lastUsedFrame = frameCounter;
+            }
+
+            texture.shadowMips.clear();
+        }
+
+        residentBytes = 0;
+
+        vkd.vkUnmapMemory(device, stagingBufferMemory);
+        bufferHandler.destroyBuffer(device, stagingBuffer, stagingBufferMemory);
+
+        mappedStaging = nullptr;
+        device = VK_NULL_HANDLE;
+    }
+
+    //  Counterpart of `releaseDeviceResources` for the recreated device
+    //  The textures are uploaded again over the next frames' `update` calls
+    void restoreDeviceResources(VkPhysicalDevice physicalDevice, VkDevice device) {
+        createDeviceResources(physicalDevice, device);
+    }
+
+    void cleanupTextureStreaming(VkDevice device) {
+
+        {
+            std::lock_guard<std::mutex> lock(streamingMutex);
+            stopStreaming = true;
+        }
+
+        streamingCondition.notify_all();
+        streamingThread.join();
+
+        vkd.vkDeviceWaitIdle(device);
+
+        for (Texture& texture : textures) {
+            destroyImage(texture.image, texture.memory, texture.view);
+        }
+
+        for (RetiredImage& retired : retiredImages) {
+            destroyImage(retired.image, retired.memory, retired.view);
+        }
+
+        textures.clear();
+        retiredImages.clear();
+        lru.clear();
+        residentBytes = 0;
+        pendingBytes = 0;
+
+        vkd.vkUnmapMemory(device, stagingBufferMemory);
+        bufferHandler.destroyBuffer(device, stagingBuffer, stagingBufferMemory);
+    }
+
+    //  Texel block of a format the streamer can size
+    //  Uncompressed formats are 1x1 blocks
+    struct FormatBlock {
+        uint32_t width;
+        uint32_t height;
+        uint32_t bytes;
+    };
+
+    //  Block size of `format`, zero bytes when the streamer does not know it
+    static FormatBlock formatBlock(VkFormat format) {
+
+        switch (format) {
+            case VK_FORMAT_R8_UNORM:
+                return { 1, 1, 1 };
+            case VK_FORMAT_R8G8_UNORM:
+                return { 1, 1, 2 };
+            case VK_FORMAT_R8G8B8A8_UNORM:
+            case VK_FORMAT_R8G8B8A8_SRGB:
+            case VK_FORMAT_B8G8R8A8_UNORM:
+            case VK_FORMAT_B8G8R8A8_SRGB:
+                return { 1, 1, 4 };
+            case VK_FORMAT_R16G16B16A16_SFLOAT:
+                return { 1, 1, 8 };
+            case VK_FORMAT_R32G32B32A32_SFLOAT:
+                return { 1, 1, 16 };
+            case VK_FORMAT_BC1_RGB_UNORM_BLOCK:
+            case VK_FORMAT_BC1_RGB_SRGB_BLOCK:
+            case VK_FORMAT_BC1_RGBA_UNORM_BLOCK:
+            case VK_FORMAT_BC1_RGBA_SRGB_BLOCK:
+            case VK_FORMAT_BC4_UNORM_BLOCK:
+            case VK_FORMAT_BC4_SNORM_BLOCK:
+            case VK_FORMAT_ETC2_R8G8B8_UNORM_BLOCK:
+            case VK_FORMAT_ETC2_R8G8B8_SRGB_BLOCK:
+            case VK_FORMAT_ETC2_R8G8B8A1_UNORM_BLOCK:
+            case VK_FORMAT_ETC2_R8G8B8A1_SRGB_BLOCK:
+            case VK_FORMAT_EAC_R11_UNORM_BLOCK:
+            case VK_FORMAT_EAC_R11_SNORM_BLOCK:
+                return { 4, 4, 8 };
+            case VK_FORMAT_BC2_UNORM_BLOCK:
+            case VK_FORMAT_BC2_SRGB_BLOCK:
+            case VK_FORMAT_BC3_UNORM_BLOCK:
+            case VK_FORMAT_BC3_SRGB_BLOCK:
+            case VK_FORMAT_BC5_UNORM_BLOCK:
+            case VK_FORMAT_BC5_SNORM_BLOCK:
+            case VK_FORMAT_BC6H_UFLOAT_BLOCK:
+            case VK_FORMAT_BC6H_SFLOAT_BLOCK:
+            case VK_FORMAT_BC7_UNORM_BLOCK:
+            case VK_FORMAT_BC7_SRGB_BLOCK:
+            case VK_FORMAT_ETC2_R8G8B8A8_UNORM_BLOCK:
+            case VK_FORMAT_ETC2_R8G8B8A8_SRGB_BLOCK:
+            case VK_FORMAT_EAC_R11G11_UNORM_BLOCK:
+            case VK_FORMAT_EAC_R11G11_SNORM_BLOCK:
+                return { 4, 4, 16 };
+            case VK_FORMAT_ASTC_4x4_UNORM_BLOCK:
+            case VK_FORMAT_ASTC_4x4_SRGB_BLOCK:
+                return { 4, 4, 16 };
+            case VK_FORMAT_ASTC_5x4_UNORM_BLOCK:
+            case VK_FORMAT_ASTC_5x4_SRGB_BLOCK:
+                return { 5, 4, 16 };
+            case VK_FORMAT_ASTC_5x5_UNORM_BLOCK:
+            case VK_FORMAT_ASTC_5x5_SRGB_BLOCK:
+                return { 5, 5, 16 };
+            case VK_FORMAT_ASTC_6x5_UNORM_BLOCK:
+            case VK_FORMAT_ASTC_6x5_SRGB_BLOCK:
+                return { 6, 5, 16 };
+            case VK_FORMAT_ASTC_6x6_UNORM_BLOCK:
+            case VK_FORMAT_ASTC_6x6_SRGB_BLOCK:
+                return { 6, 6, 16 };
+            case VK_FORMAT_ASTC_8x5_UNORM_BLOCK:
+            case VK_FORMAT_ASTC_8x5_SRGB_BLOCK:
+                return { 8, 5, 16 };
+            case VK_FORMAT_ASTC_8x6_UNORM_BLOCK:
+            case VK_FORMAT_ASTC_8x6_SRGB_BLOCK:
+                return { 8, 6, 16 };
+            case VK_FORMAT_ASTC_8x8_UNORM_BLOCK:
+            case VK_FORMAT_ASTC_8x8_SRGB_BLOCK:
+                return { 8, 8, 16 };
+            case VK_FORMAT_ASTC_10x5_UNORM_BLOCK:
+            case VK_FORMAT_ASTC_10x5_SRGB_BLOCK:
+                return { 10, 5, 16 };
+            case VK_FORMAT_ASTC_10x6_UNORM_BLOCK:
+            case VK_FORMAT_ASTC_10x6_SRGB_BLOCK:
+                return { 10, 6, 16 };
+            case VK_FORMAT_ASTC_10x8_UNORM_BLOCK:
+            case VK_FORMAT_ASTC_10x8_SRGB_BLOCK:
+                return { 10, 8, 16 };
+            case VK_FORMAT_ASTC_10x10_UNORM_BLOCK:
+            case VK_FORMAT_ASTC_10x10_SRGB_BLOCK:
+                return { 10, 10, 16 };
+            case VK_FORMAT_ASTC_12x10_UNORM_BLOCK:
+            case VK_FORMAT_ASTC_12x10_SRGB_BLOCK:
+                return { 12, 10, 16 };
+            case VK_FORMAT_ASTC_12x12_UNORM_BLOCK:
+            case VK_FORMAT_ASTC_12x12_SRGB_BLOCK:
+                return { 12, 12, 16 };
+            default:
+                return { 0, 0, 0 };
+        }
+    }
+
+    //  Levels in a chain from `width` x `height` down to 1x1
+    static uint32_t fullMipChainLength(uint32_t width, uint32_t height) {
+
+        uint32_t levels = 1;
+
+        while ((std::max(width, height) >> levels) != 0) {
+            levels++;
+        }
+
+        return levels;
+    }
+
+    static bool isKnownFormat(VkFormat format) {
+        return formatBlock(format).bytes != 0;
+    }
+
+    //  Size of one mip level in bytes, tightly packed
+    //  Partial blocks at the edges still take a whole block
+    //  Only valid for formats `isKnownFormat` accepts, `registerTexture` rejects the others
+    static VkDeviceSize mipByteSize(VkFormat format, uint32_t width, uint32_t height) {
+
+        FormatBlock block = formatBlock(format);
+
+        if (block.bytes == 0) {
+            return 0;
+        }
+
+        return static_cast<VkDeviceSize>((width + block.width - 1) / block.width) * ((height + block.height - 1) / block.height) * block.bytes;
+    }
+
+private:
+
+    struct LoadJob {
+        TextureId id;
+        uint32_t mip;
+        std::function<std::vector<uint8_t>(uint32_t)> loadMip;
+    };
+
+    struct LoadResult {
+        TextureId id;
+        uint32_t mip;
+        std::vector<uint8_t> data;
+
+        //  What `loadMip` threw, `data` is empty then
+        bool failed = false;
+        std::string error;
+    };
+
+    //  An image replaced by a new resident range
+    //  Frames still in flight may sample it, so it is kept until they are done
+    struct RetiredImage {
+        VkImage image;
+        VkDeviceMemory memory;
+        VkImageView view;
+        uint64_t retiredFrame;
+    };
+
+    BufferHandler bufferHandler;
+    VkPhysicalDevice physicalDevice = VK_NULL_HANDLE;
+    VkDevice device = VK_NULL_HANDLE;
+    VkDeviceSize budgetOverride = 0;
+
+    std::vector<Texture> textures;
+
+    //  Front is the least recently used texture
+    std::list<TextureId> lru;
+
+    std::vector<RetiredImage> retiredImages;
+    uint64_t frameCounter = 1;
+
+    VkDeviceSize budget = 0;
+    VkDeviceSize residentBytes = 0;
+
+    //  Bytes of levels requested but not resident yet, counted against the budget
+    VkDeviceSize pendingBytes = 0;
+
+    VkBuffer stagingBuffer = VK_NULL_HANDLE;
+    VkDeviceMemory stagingBufferMemory = VK_NULL_HANDLE;
+    void* mappedStaging = nullptr;
+    VkDeviceSize stagingBase = 0;
+    VkDeviceSize stagingOffset = 0;
+
+    std::thread streamingThread;
+    std::mutex streamingMutex;
+    std::condition_variable streamingCondition;
+    std::deque<LoadJob> loadJobs;
+    std::vector<LoadResult> loadResults;
+    bool stopStreaming = false;
+
+    void createDeviceResources(VkPhysicalDevice physicalDevice, VkDevice device) {
+
+        this->physicalDevice = physicalDevice;
+        this->device = device;
+
+        budget = budgetOverride != 0 ? budgetOverride : queryBudget(physicalDevice);
+
+        bufferHandler.createBuffer(physicalDevice, device, STAGING_SIZE * FrameResourcesHandler::MAX_FRAMES_IN_FLIGHT, VK_BUFFER_USAGE_TRANSFER_SRC_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, stagingBuffer, stagingBufferMemory);
+        if (vkd.vkMapMemory(device, stagingBufferMemory, 0, STAGING_SIZE * FrameResourcesHandler::MAX_FRAMES_IN_FLIGHT, 0, &mappedStaging) != VK_SUCCESS) {
+            throw std::runtime_error("Failed to map texture staging memory!");
+        }
+    }
+
+    //  The budget is a fraction of the largest device local heap of the selected device
+    VkDeviceSize queryBudget(VkPhysicalDevice physicalDevice) {
+
+        VkPhysicalDeviceMemoryProperties memProperties;
+        vkd.vkGetPhysicalDeviceMemoryProperties(physicalDevice, &memProperties);
+
+        VkDeviceSize largestHeap = 0;
+
+        for (uint32_t i = 0; i < memProperties.memoryHeapCount; i++) {
+            if (memProperties.memoryHeaps[i].flags & VK_MEMORY_HEAP_DEVICE_LOCAL_BIT) {
+                largestHeap = std::max(largestHeap, memProperties.memoryHeaps[i].size);
+            }
+        }
+
+        return static_cast<VkDeviceSize>(largestHeap * DEFAULT_BUDGET_FRACTION);
+    }
+
+    VkDeviceSize levelBytes(const Texture& texture, uint32_t mip) const {
+        return mipByteSize(texture.source.format, mipWidth(texture, mip), mipHeight(texture, mip));
+    }
+
+    static uint32_t mipWidth(const Texture& texture, uint32_t mip) {
+        return std::max(1u, texture.source.width >> mip);
+    }
+
+    static uint32_t mipHeight(const Texture& texture, uint32_t mip) {
+        return std::max(1u, texture.source.height >> mip);
+    }
+
+    void streamingLoop() {
+
+        while (true) {
+            LoadJob job;
+
+            {
+                std::unique_lock<std::mutex> lock(streamingMutex);
+                streamingCondition.wait(lock, [this] { return stopStreaming || !loadJobs.empty(); });
+
+                if (stopStreaming) {
+                    return;
+                }
+
+                job = std::move(loadJobs.front());
+                loadJobs.pop_front();
+            }
+
+            LoadResult result;
+            result.id = job.id;
+            result.mip = job.mip;
+
+            //  An exception escaping the thread would terminate the program,
+            //  the render thread marks the texture as failed instead
+            try {
+                result.data = job.loadMip(job.mip);
+            } catch (const std::exception& e) {
+                result.failed = true;
+                result.error = e.what();
+            }
+
+            std::lock_guard<std::mutex> lock(streamingMutex);
+            loadResults.push_back(std::move(result));
+        }
+    }
+
+    void collectLoadedMips() {
+
+        std::vector<LoadResult> results;
+
+        {
+            std::lock_guard<std::mutex> lock(streamingMutex);
+            results.swap(loadResults);
+        }
+
+        for (LoadResult& result : results) {
+            Texture& texture = textures[result.id];
+
+            //  The level was evicted from the plan while it was loading
+            if (result.mip < texture.requestedMip || result.mip >= texture.residentMip) {
+                continue;
+            }
+
+            if (result.failed) {
+                failTexture(result.id, result.mip, result.error);
+                continue;
+            }
+
+            if (result.data.size() < levelBytes(texture, result.mip)) {
+                failTexture(result.id, result.mip, "data is too small");
+                continue;
+            }
+
+            texture.loadedMips[result.mip] = std::move(result.data);
+        }
+    }
+
+    //  Stops streaming the texture past `mip`
+    //  The planned levels finer than it are dropped, the coarser ones still
+    //  arrive and are uploaded so the texture has something to sample
+    void failTexture(TextureId id, uint32_t mip, const std::string& error) {
+
+        std::cerr << "Failed to load mip level " << mip << " of texture " << id << ": " << error << std::endl;
+
+        Texture& texture = textures[id];
+        texture.failed = true;
+
+        for (uint32_t level = texture.requestedMip; level <= mip; level++) {
+            pendingBytes -= levelBytes(texture, level);
+            texture.loadedMips.erase(level);
+        }
+
+        texture.requestedMip = mip + 1;
+    }
+
+    //  Queues loads for textures used this frame that need finer levels
+    void requestLoads() {
+
+        std::vector<LoadJob> jobs;
+
+        for (TextureId id = 0; id < textures.size(); id++) {
+            Texture& texture = textures[id];
+
+            if (texture.failed) {
+                continue;
+            }
+
+            if (texture.lastUsedFrame != frameCounter && texture.residentMip < texture.source.mipLevels) {
+                continue;
+            }
+
+            uint32_t firstLevel = std::min(texture.requestedMip, texture.residentMip);
+
+            //  Coarsest first, the resident chain can only grow one level at a time
+            for (uint32_t mip = firstLevel; mip-- > texture.desiredMip; ) {
+
+                VkDeviceSize bytes = levelBytes(texture, mip);
+
+                if (!makeRoom(bytes)) {
+                    break;
+                }
+
+                pendingBytes += bytes;
+                texture.requestedMip = mip;
+                jobs.push_back({ id, mip, texture.source.loadMip });
+            }
+        }
+
+        if (jobs.empty()) {
+            return;
+        }
+
+        {
+            std::lock_guard<std::mutex> lock(streamingMutex);
+
+            for (LoadJob& job : jobs) {
+                loadJobs.push_back(std::move(job));
+            }
+        }
+
+        streamingCondition.notify_one();
+    }
+
+    //  Evicts levels from the least recently used textures until `bytes`
+    //  more fit in the budget
+    //  Textures used this frame are never evicted
+    bool makeRoom(VkDeviceSize bytes) {
+
+        for (auto it = lru.begin(); it != lru.end() && residentBytes + pendingBytes + bytes > budget; ) {
+            Texture& texture = textures[*it];
+
+            //  Everything after this one was used this frame as well
+            if (texture.lastUsedFrame == frameCounter) {
+                break;
+            }
+
+            dropPlannedLevels(texture);
+
+            //  Keep at least the smallest level, textures with nothing resident have nothing to give
+            if (texture.targetMip + 1 < texture.source.mipLevels) {
+                residentBytes -= levelBytes(texture, texture.targetMip);
+                texture.targetMip++;
+                texture.requestedMip = std::max(texture.requestedMip, texture.targetMip);
+                texture.desiredMip = std::max(texture.desiredMip, texture.targetMip);
+            } else {
+                ++it;
+            }
+        }
+
+        return residentBytes + pendingBytes + bytes <= budget;
+    }
+
+    //  Levels of an evicted texture that were requested or loaded but not
+    //  uploaded yet no longer count against the budget
+    void dropPlannedLevels(Texture& texture) {
+
+        for (uint32_t mip = texture.requestedMip; mip < texture.residentMip; mip++) {
+            pendingBytes -= levelBytes(texture, mip);
+        }
+
+        //  Nothing finer than the planned range is pending any more, this must
+        //  not drop below `targetMip` or the levels being evicted would be
+        //  taken for pending ones the next time round
+        texture.requestedMip = std::max(texture.residentMip, texture.targetMip);
+        texture.loadedMips.clear();
+    }
+
+    //  Space a level takes in the staging buffer, copies start 16 byte aligned
+    VkDeviceSize stagingLevelBytes(const Texture& texture, uint32_t mip) const {
+        return (levelBytes(texture, mip) + 15) & ~VkDeviceSize(15);
+    }
+
+    //  Replaces the texture's image with one holding [newResidentMip .. mipLevels - 1]
+    void reallocate(VkCommandBuffer commandBuffer, Texture& texture, uint32_t newResidentMip) {
+
+        uint32_t mipLevels = texture.source.mipLevels;
+        uint32_t newLevelCount = mipLevels - newResidentMip;
+
+        VkImage image;
+        VkDeviceMemory memory;
+        createImage(texture, newResidentMip, newLevelCount, image, memory);
+
+        transitionImage(commandBuffer, image, 0, newLevelCount, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 0, VK_ACCESS_TRANSFER_WRITE_BIT, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT);
+
+        //  Levels both images hold are copied on the GPU
+        if (texture.image != VK_NULL_HANDLE) {
+
+            uint32_t oldLevelCount = mipLevels - texture.residentMip;
+
+            transitionImage(commandBuffer, texture.image, 0, oldLevelCount, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, VK_ACCESS_SHADER_READ_BIT, VK_ACCESS_TRANSFER_READ_BIT, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT);
+
+            std::vector<VkImageCopy> regions;
+
+            for (uint32_t mip = std::max(texture.residentMip, newResidentMip); mip < mipLevels; mip++) {
+                VkImageCopy region{};
+                region.srcSubresource = { VK_IMAGE_ASPECT_COLOR_BIT, mip - texture.residentMip, 0, 1 };
+                region.dstSubresource = { VK_IMAGE_ASPECT_COLOR_BIT, mip - newResidentMip, 0, 1 };
+                region.extent = { mipWidth(texture, mip), mipHeight(texture, mip), 1 };
+                regions.push_back(region);
+            }
+
+            vkd.vkCmdCopyImage(commandBuffer, texture.image, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, static_cast<uint32_t>(regions.size()), regions.data());
+
+            //  Old images only ever go away through retirement, the layout they are left in does not matter
+            //  Evicted levels were already taken off `residentBytes` when the eviction was planned
+            retiredImages.push_back({ texture.image, texture.memory, texture.view, frameCounter });
+        }
+
+        //  Levels the old image did not have come from the staging buffer
+        for (uint32_t mip = newResidentMip; mip < texture.residentMip; mip++) {
+
+            std::vector<uint8_t>& data = texture.loadedMips[mip];
+            VkDeviceSize bytes = levelBytes(texture, mip);
+            VkDeviceSize offset = stagingBase + stagingOffset;
+
+            memcpy(static_cast<char*>(mappedStaging) + offset, data.data(), bytes);
+            stagingOffset += stagingLevelBytes(texture, mip);
+
+            VkBufferImageCopy region{};
+            region.bufferOffset = offset;
+            region.imageSubresource = { VK_IMAGE_ASPECT_COLOR_BIT, mip - newResidentMip, 0, 1 };
+            region.imageExtent = { mipWidth(texture, mip), mipHeight(texture, mip), 1 };
+
+            vkd.vkCmdCopyBufferToImage(commandBuffer, stagingBuffer, image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1, &region);
+
+            if (keepHostShadow) {
+                texture.shadowMips[mip] = std::move(data);
+            }
+
+            texture.loadedMips.erase(mip);
+            pendingBytes -= bytes;
+            residentBytes += bytes;
+        }
+
+        transitionImage(commandBuffer, image, 0, newLevelCount, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, VK_ACCESS_TRANSFER_WRITE_BIT, VK_ACCESS_SHADER_READ_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT);
+
+        texture.image = image;
+        texture.memory = memory;
+        texture.view = createImageView(image, texture.source.format, newLevelCount);
+        texture.residentMip = newResidentMip;
+        texture.targetMip = newResidentMip;
+
+        //  Evicted levels leave the shadow with the image
+        texture.shadowMips.erase(texture.shadowMips.begin(), texture.shadowMips.lower_bound(newResidentMip));
+    }
+
+    void createImage(const Texture& texture, uint32_t firstMip, uint32_t levelCount, VkImage& image, VkDeviceMemory& memory) {
+
+        VkImageCreateInfo imageInfo{};
+        imageInfo.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
+        imageInfo.imageType = VK_IMAGE_TYPE_2D;
+        imageInfo.extent = { mipWidth(texture, firstMip), mipHeight(texture, firstMip), 1 };
+        imageInfo.mipLevels = levelCount;
+        imageInfo.arrayLayers = 1;
+        imageInfo.format = texture.source.format;
+        imageInfo.tiling = VK_IMAGE_TILING_OPTIMAL;
+        imageInfo.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+
+        //  TRANSFER_SRC so the levels can be copied into the next image when the range changes
+        imageInfo.usage = VK_IMAGE_USAGE_TRANSFER_SRC_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_SAMPLED_BIT;
+        imageInfo.samples = VK_SAMPLE_COUNT_1_BIT;
+        imageInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+
+        if (vkd.vkCreateImage(device, &imageInfo, nullptr, &image) != VK_SUCCESS) {
+            throw std::runtime_error("Failed to create streamed texture image!");
+        }
+
+        VkMemoryRequirements memRequirements;
+        vkd.vkGetImageMemoryRequirements(device, image, &memRequirements);
+
+        VkMemoryAllocateInfo allocInfo{};
+        allocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+        allocInfo.allocationSize = memRequirements.size;
+        allocInfo.memoryTypeIndex = bufferHandler.findMemoryType(physicalDevice, memRequirements.memoryTypeBits, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+
+        if (vkd.vkAllocateMemory(device, &allocInfo, nullptr, &memory) != VK_SUCCESS) {
+            throw std::runtime_error("Failed to allocate streamed texture memory!");
+        }
+
+        if (vkd.vkBindImageMemory(device, image, memory, 0) != VK_SUCCESS) {
+            throw std::runtime_error("Failed to bind streamed texture memory!");
+        }
+    }
+
+    VkImageView createImageView(VkImage image, VkFormat format, uint32_t levelCount) {
+
+        VkImageViewCreateInfo viewInfo{};
+        viewInfo.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
+        viewInfo.image = image;
+        viewInfo.viewType = VK_IMAGE_VIEW_TYPE_2D;
+        viewInfo.format = format;
+        viewInfo.subresourceRange = { VK_IMAGE_ASPECT_COLOR_BIT, 0, levelCount, 0, 1 };
+
+        VkImageView view;
+
+        if (vkd.vkCreateImageView(device, &viewInfo, nullptr, &view) != VK_SUCCESS) {
+            throw std::runtime_error("Failed to create streamed texture image view!");
+        }
+
+        return view;
+    }
+
+    void transitionImage(VkCommandBuffer commandBuffer, VkImage image, uint32_t baseMip, uint32_t levelCount, VkImageLayout oldLayout, VkImageLayout newLayout, VkAccessFlags srcAccess, VkAccessFlags dstAccess, VkPipelineStageFlags srcStage, VkPipelineStageFlags dstStage) {
+
+        VkImageMemoryBarrier barrier{};
+        barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+        barrier.oldLayout = oldLayout;
+        barrier.newLayout = newLayout;
+        barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+        barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+        barrier.image = image;
+        barrier.subresourceRange = { VK_IMAGE_ASPECT_COLOR_BIT, baseMip, levelCount, 0, 1 };
+        barrier.srcAccessMask = srcAccess;
+        barrier.dstAccessMask = dstAccess;
+
+        vkd.vkCmdPipelineBarrier(commandBuffer, srcStage, dstStage, 0, 0, nullptr, 0, nullptr, 1, &barrier);
+    }
+
+    //  An image retired in frame N may be sampled by every frame in flight
+    //  at that point, it is safe to destroy once that many frames have passed
+    void destroyRetiredImages() {
+
+        auto isSafe = [this](const RetiredImage& retired) {
+            return frameCounter >= retired.retiredFrame + FrameResourcesHandler::MAX_FRAMES_IN_FLIGHT;
+        };
+
+        for (RetiredImage& retired : retiredImages) {
+            if (isSafe(retired)) {
+                destroyImage(retired.image, retired.memory, retired.view);
+            }
+        }
+
+        retiredImages.erase(std::remove_if(retiredImages.begin(), retiredImages.end(), isSafe), retiredImages.end());
+    }
+
+    void destroyImage(VkImage image, VkDeviceMemory memory, VkImageView view) {
+        vkd.vkDestroyImageView(device, view, nullptr);
+        vkd.vkDestroyImage(device, image, nullptr);
+        vkd.vkFreeMemory(device, memory, nullptr);
+    }
+
+};
+
+#endif /* textureStreamingHandler_h */
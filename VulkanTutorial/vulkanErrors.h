@@ -0,0 +1,43 @@
+#ifndef vulkanErrors_h
+#define vulkanErrors_h
+
+#define GLFW_INCLUDE_VULKAN
+#include <GLFW/glfw3.h>
+#include <stdexcept> // To report and propagate errors
+#include <string>
+
+//  Most Vulkan errors are fatal and are reported with std::runtime_error
+//  Losing the device or the surface is not, the application can tear both
+//  down and build them again without restarting, so those two get their
+//  own types that the main loop catches
+
+//  VK_ERROR_DEVICE_LOST, the logical device and every object created from
+//  it have to be destroyed and created again
+class DeviceLostError : public std::runtime_error {
+public:
+    using std::runtime_error::runtime_error;
+};
+
+//  VK_ERROR_SURFACE_LOST_KHR, the surface has to be created again from the window
+class SurfaceLostError : public std::runtime_error {
+public:
+    using std::runtime_error::runtime_error;
+};
+
+//  Throws the error type matching `result` unless it is VK_SUCCESS
+//  Called every frame, the message is only turned into a string once it has to be thrown
+inline void checkResult(VkResult result, const char* message) {
+
+    switch (result) {
+        case VK_SUCCESS:
+            return;
+        case VK_ERROR_DEVICE_LOST:
+            throw DeviceLostError(std::string(message) + " (device lost)");
+        case VK_ERROR_SURFACE_LOST_KHR:
+            throw SurfaceLostError(std::string(message) + " (surface lost)");
+        default:
+            throw std::runtime_error(message);
+    }
+}
+
+#endif /* vulkanErrors_h */
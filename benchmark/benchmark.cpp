@@ -0,0 +1,642 @@
+/// Headless benchmark for the renderer building blocks
+/// It reuses the handlers from the VulkanTutorial target, but creates no window or surface,
+/// so it can run on a software ICD (lavapipe) on a Linux machine without a display
+/// Results are written as JSON so two runs can be diffed across commits
+
+#include "physicalDeviceHandler.hpp"
+#include "logicalDeviceHandler.h"
+#include "frameResourcesHandler.h"
+#include "bufferHandler.h"
+#include "frameArena.h"
+#include "simdMath.h"
+#include "headlessInstance.h"
+#include "nullVertexShader.h"
+
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cmath>
+#include <fstream>
+#include <limits>
+#include <random>
+#include <string>
+
+#include <dlfcn.h>
+
+using Clock = std::chrono::steady_clock;
+
+static double millisecondsSince(Clock::time_point start) {
+    return std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+}
+
+/// A scene is a fixed, seeded set of objects so every run sees exactly the same work
+struct Scene {
+    const char* name;
+    uint32_t objectCount;
+    uint32_t seed;
+};
+
+const std::array<Scene, 2> scenes = {{
+    { "small", 1000, 1 },
+    { "large", 20000, 2 },
+}};
+
+/// Flat key/value writer, keys are kept in insertion order so two result files diff line by line
+class JsonWriter {
+
+public:
+
+    void add(const std::string& key, double value) {
+        /// JSON has no infinity or NaN, a rate over a zero duration is written as null
+        entries.push_back("  " + quoted(key) + ": " + (std::isfinite(value) ? std::to_string(value) : "null"));
+    }
+
+    void add(const std::string& key, const std::string& value) {
+        entries.push_back("  " + quoted(key) + ": " + quoted(value));
+    }
+
+    void write(std::ostream& out) const {
+        out << "{\n";
+
+        for (size_t i = 0; i < entries.size(); i++) {
+            out << entries[i] << (i + 1 < entries.size() ? ",\n" : "\n");
+        }
+
+        out << "}\n";
+    }
+
+private:
+
+    std::vector<std::string> entries;
+
+    /// Strings such as the device name come from the driver, quotes, backslashes and control characters are escaped
+    static std::string quoted(const std::string& text) {
+
+        std::string result = "\"";
+
+        for (char c : text) {
+            switch (c) {
+                case '"': result += "\\\""; break;
+                case '\\': result += "\\\\"; break;
+                case '\b': result += "\\b"; break;
+                case '\f': result += "\\f"; break;
+                case '\n': result += "\\n"; break;
+                case '\r': result += "\\r"; break;
+                case '\t': result += "\\t"; break;
+                default:
+                    if (static_cast<unsigned char>(c) < 0x20) {
+                        char escape[7];
+                        snprintf(escape, sizeof(escape), "\\u%04x", static_cast<unsigned char>(c));
+                        result += escape;
+                    } else {
+                        result += c;
+                    }
+            }
+        }
+
+        return result + "\"";
+    }
+};
+
+class BenchmarkApplication {
+
+    PhysicalDeviceHandler physicalDeviceHandler;
+    LogicalDeviceHandler logicalDeviceHandler;
+    FrameResourcesHandler frameResourcesHandler;
+    BufferHandler bufferHandler;
+    FrameArena frameArena;
+
+public:
+
+    const uint32_t WARMUP_FRAMES = 10;
+    const uint32_t MEASURED_FRAMES = 200;
+    const uint32_t DRAW_CALLS = 100000;
+    const VkDeviceSize UPLOAD_SIZE = 64 * 1024 * 1024;
+    const uint32_t UPLOAD_ITERATIONS = 10;
+    const uint32_t DISPATCH_CALLS = 1000000;
+    const uint32_t DISPATCH_ROUNDS = 5;
+
+    void run(const std::string& outputPath) {
+        initVulkan();
+        createPipeline();
+
+        benchmarkCulling();
+
+        for (const Scene& scene : scenes) {
+            benchmarkScene(scene);
+        }
+
+        benchmarkUpload();
+        benchmarkDrawCalls();
+        benchmarkDispatch();
+
+        cleanup();
+
+        std::ofstream file(outputPath);
+
+        if (!file) {
+            throw std::runtime_error("Failed to open " + outputPath);
+        }
+
+        results.write(file);
+        std::cout << "Benchmark results written to " << outputPath << std::endl;
+    }
+
+private:
+
+    VkInstance instance;
+    VkRenderPass renderPass;
+    VkFramebuffer framebuffer;
+    VkPipelineLayout pipelineLayout;
+    VkPipeline pipeline;
+
+    JsonWriter results;
+
+    void initVulkan() {
+
+        auto start = Clock::now();
+        instance = createHeadlessInstance("Benchmark");
+        results.add("init.instance_ms", millisecondsSince(start));
+
+        start = Clock::now();
+        physicalDeviceHandler.pickPhysicalDevice(instance, {});
+        results.add("init.physical_device_ms", millisecondsSince(start));
+
+        start = Clock::now();
+        logicalDeviceHandler.createLogicalDevice(physicalDeviceHandler.physicalDevice, {});
+        frameResourcesHandler.createFrameResources(physicalDeviceHandler.physicalDevice, logicalDeviceHandler.device, logicalDeviceHandler.queueFamilyIndices.graphicsFamily.value());
+        results.add("init.logical_device_ms", millisecondsSince(start));
+
+        VkPhysicalDeviceProperties properties;
+        vkd.vkGetPhysicalDeviceProperties(physicalDeviceHandler.physicalDevice, &properties);
+        results.add("device.name", properties.deviceName);
+        results.add("simd.backend", simdMath::backendName());
+    }
+
+    /// A render pass without attachments and a pipeline that only runs the vertex stage
+    /// This is enough to measure the cost of issuing and executing draw calls
+    void createPipeline() {
+
+        VkDevice device = logicalDeviceHandler.device;
+
+        VkSubpassDescription subpass{};
+        subpass.pipelineBindPoint = VK_PIPELINE_BIND_POINT_GRAPHICS;
+
+        VkRenderPassCreateInfo renderPassInfo{};
+        renderPassInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_CREATE_INFO;
+        renderPassInfo.subpassCount = 1;
+        renderPassInfo.pSubpasses = &subpass;
+
+        if (vkd.vkCreateRenderPass(device, &renderPassInfo, nullptr, &renderPass) != VK_SUCCESS) {
+            throw std::runtime_error("Failed to create render pass!");
+        }
+
+        VkFramebufferCreateInfo framebufferInfo{};
+        framebufferInfo.sType = VK_STRUCTURE_TYPE_FRAMEBUFFER_CREATE_INFO;
+        framebufferInfo.renderPass = renderPass;
+        framebufferInfo.width = 1;
+        framebufferInfo.height = 1;
+        framebufferInfo.layers = 1;
+
+        if (vkd.vkCreateFramebuffer(device, &framebufferInfo, nullptr, &framebuffer) != VK_SUCCESS) {
+            throw std::runtime_error("Failed to create framebuffer!");
+        }
+
+        VkShaderModuleCreateInfo shaderInfo{};
+        shaderInfo.sType = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO;
+        shaderInfo.codeSize = sizeof(NULL_VERTEX_SHADER);
+        shaderInfo.pCode = NULL_VERTEX_SHADER;
+
+        VkShaderModule vertexShader;
+
+        if (vkd.vkCreateShaderModule(device, &shaderInfo, nullptr, &vertexShader) != VK_SUCCESS) {
+            throw std::runtime_error("Failed to create shader module!");
+        }
+
+        VkPipelineShaderStageCreateInfo stageInfo{};
+        stageInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+        stageInfo.stage = VK_SHADER_STAGE_VERTEX_BIT;
+        stageInfo.module = vertexShader;
+        stageInfo.pName = "main";
+
+        VkPipelineVertexInputStateCreateInfo vertexInput{};
+        vertexInput.sType = VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO;
+
+        VkPipelineInputAssemblyStateCreateInfo inputAssembly{};
+        inputAssembly.sType = VK_STRUCTURE_TYPE_PIPELINE_INPUT_ASSEMBLY_STATE_CREATE_INFO;
+        inputAssembly.topology = VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST;
+
+        VkPipelineRasterizationStateCreateInfo rasterizer{};
+        rasterizer.sType = VK_STRUCTURE_TYPE_PIPELINE_RASTERIZATION_STATE_CREATE_INFO;
+        rasterizer.rasterizerDiscardEnable = VK_TRUE;
+        rasterizer.polygonMode = VK_POLYGON_MODE_FILL;
+        rasterizer.lineWidth = 1.0f;
+
+        VkPipelineLayoutCreateInfo layoutInfo{};
+        layoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+
+        if (vkd.vkCreatePipelineLayout(device, &layoutInfo, nullptr, &pipelineLayout) != VK_SUCCESS) {
+            throw std::runtime_error("Failed to create pipeline layout!");
+        }
+
+        VkGraphicsPipelineCreateInfo pipelineInfo{};
+        pipelineInfo.sType = VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_CREATE_INFO;
+        pipelineInfo.stageCount = 1;
+        pipelineInfo.pStages = &stageInfo;
+        pipelineInfo.pVertexInputState = &vertexInput;
+        pipelineInfo.pInputAssemblyState = &inputAssembly;
+        pipelineInfo.pRasterizationState = &rasterizer;
+        pipelineInfo.layout = pipelineLayout;
+        pipelineInfo.renderPass = renderPass;
+        pipelineInfo.subpass = 0;
+
+        auto start = Clock::now();
+
+        if (vkd.vkCreateGraphicsPipelines(device, VK_NULL_HANDLE, 1, &pipelineInfo, nullptr, &pipeline) != VK_SUCCESS) {
+            throw std::runtime_error("Failed to create graphics pipeline!");
+        }
+
+        results.add("init.pipeline_ms", millisecondsSince(start));
+
+        vkd.vkDestroyShaderModule(device, vertexShader, nullptr);
+    }
+
+    /// Starts recording the current frame's command buffer inside the attachment-less render pass
+    VkCommandBuffer beginRecording() {
+
+        VkCommandBuffer commandBuffer = frameResourcesHandler.allocateCommandBuffer(logicalDeviceHandler.device);
+
+        VkCommandBufferBeginInfo beginInfo{};
+        beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+        beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+        vkd.vkBeginCommandBuffer(commandBuffer, &beginInfo);
+
+        VkRenderPassBeginInfo renderPassInfo{};
+        renderPassInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO;
+        renderPassInfo.renderPass = renderPass;
+        renderPassInfo.framebuffer = framebuffer;
+        renderPassInfo.renderArea.extent = { 1, 1 };
+
+        vkd.vkCmdBeginRenderPass(commandBuffer, &renderPassInfo, VK_SUBPASS_CONTENTS_INLINE);
+        vkd.vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pipeline);
+
+        return commandBuffer;
+    }
+
+    void submitRecording(VkCommandBuffer commandBuffer) {
+
+        vkd.vkCmdEndRenderPass(commandBuffer);
+        vkd.vkEndCommandBuffer(commandBuffer);
+
+        VkSubmitInfo submitInfo{};
+        submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+        submitInfo.commandBufferCount = 1;
+        submitInfo.pCommandBuffers = &commandBuffer;
+
+        frameResourcesHandler.submit(logicalDeviceHandler.device, logicalDeviceHandler.graphicsQueue, submitInfo);
+    }
+
+    /// Fixed frustum, an axis aligned box from -50 to 50 on every axis
+    static simdMath::Frustum benchmarkFrustum() {
+        simdMath::Frustum frustum;
+        frustum.planes[0] = {  1.0f,  0.0f,  0.0f, 50.0f };
+        frustum.planes[1] = { -1.0f,  0.0f,  0.0f, 50.0f };
+        frustum.planes[2] = {  0.0f,  1.0f,  0.0f, 50.0f };
+        frustum.planes[3] = {  0.0f, -1.0f,  0.0f, 50.0f };
+        frustum.planes[4] = {  0.0f,  0.0f,  1.0f, 50.0f };
+        frustum.planes[5] = {  0.0f,  0.0f, -1.0f, 50.0f };
+        return frustum;
+    }
+
+    /// Rotation about the y axis, used to animate the scene deterministically
+    static simdMath::Mat4 rotationY(float angle) {
+        simdMath::Mat4 rotation = simdMath::Mat4::identity();
+        rotation.m[0] = std::cos(angle);
+        rotation.m[2] = -std::sin(angle);
+        rotation.m[8] = std::sin(angle);
+        rotation.m[10] = std::cos(angle);
+        return rotation;
+    }
+
+    /// Compares the compiled SIMD backend against the scalar reference on the same boxes
+    void benchmarkCulling() {
+
+        const size_t count = 1000000;
+        const int iterations = 20;
+
+        std::mt19937 random(42);
+        std::uniform_real_distribution<float> position(-100.0f, 100.0f);
+
+        std::vector<float> minX(count), minY(count), minZ(count), maxX(count), maxY(count), maxZ(count);
+
+        for (size_t i = 0; i < count; i++) {
+            minX[i] = position(random);
+            minY[i] = position(random);
+            minZ[i] = position(random);
+            maxX[i] = minX[i] + 1.0f;
+            maxY[i] = minY[i] + 1.0f;
+            maxZ[i] = minZ[i] + 1.0f;
+        }
+
+        simdMath::AABBsSoA boxes{ minX.data(), minY.data(), minZ.data(), maxX.data(), maxY.data(), maxZ.data(), count };
+        simdMath::Frustum frustum = benchmarkFrustum();
+
+        std::vector<uint8_t> visibleSimd(count), visibleScalar(count);
+
+        auto start = Clock::now();
+        for (int i = 0; i < iterations; i++) {
+            simdMath::cullAABBs(frustum, boxes, visibleSimd.data());
+        }
+        double simdMs = millisecondsSince(start);
+
+        start = Clock::now();
+        for (int i = 0; i < iterations; i++) {
+            simdMath::scalar::cullAABBs(frustum, boxes, visibleScalar.data(), 0);
+        }
+        double scalarMs = millisecondsSince(start);
+
+        if (visibleSimd != visibleScalar) {
+            throw std::runtime_error("SIMD culling does not match the scalar reference!");
+        }
+
+        results.add("cull.simd_boxes_per_ms", count * iterations / simdMs);
+        results.add("cull.scalar_boxes_per_ms", count * iterations / scalarMs);
+    }
+
+    /// Runs the scene through the frame loop: transform update, culling, one draw per visible object
+    void benchmarkScene(const Scene& scene) {
+
+        std::mt19937 random(scene.seed);
+        std::uniform_real_distribution<float> position(-100.0f, 100.0f);
+
+        const size_t count = scene.objectCount;
+
+        std::vector<simdMath::Mat4> locals(count), worlds(count);
+        std::vector<float> centerX(count), centerY(count), centerZ(count);
+
+        for (size_t i = 0; i < count; i++) {
+            centerX[i] = position(random);
+            centerY[i] = position(random);
+            centerZ[i] = position(random);
+
+            locals[i] = simdMath::Mat4::identity();
+            locals[i].m[12] = centerX[i];
+            locals[i].m[13] = centerY[i];
+            locals[i].m[14] = centerZ[i];
+        }
+
+        simdMath::Frustum frustum = benchmarkFrustum();
+        std::vector<double> frameTimes;
+        frameTimes.reserve(MEASURED_FRAMES);
+
+        double visibleTotal = 0.0;
+
+        for (uint32_t frame = 0; frame < WARMUP_FRAMES + MEASURED_FRAMES; frame++) {
+
+            auto start = Clock::now();
+
+            frameResourcesHandler.beginFrame(logicalDeviceHandler.device);
+            frameArena.reset();
+
+            simdMath::Mat4 parent = rotationY(0.01f * frame);
+            simdMath::multiplyBatch(parent, locals.data(), worlds.data(), count);
+
+            /// Per-frame scratch comes from the arena, the loop itself does not hit the heap
+            std::pmr::vector<float> x(count, &frameArena), y(count, &frameArena), z(count, &frameArena);
+            simdMath::transformPoints(parent, centerX.data(), centerY.data(), centerZ.data(), { x.data(), y.data(), z.data(), count });
+
+            std::pmr::vector<float> minX(count, &frameArena), minY(count, &frameArena), minZ(count, &frameArena);
+            std::pmr::vector<float> maxX(count, &frameArena), maxY(count, &frameArena), maxZ(count, &frameArena);
+
+            for (size_t i = 0; i < count; i++) {
+                minX[i] = x[i] - 0.5f; maxX[i] = x[i] + 0.5f;
+                minY[i] = y[i] - 0.5f; maxY[i] = y[i] + 0.5f;
+                minZ[i] = z[i] - 0.5f; maxZ[i] = z[i] + 0.5f;
+            }
+
+            std::pmr::vector<uint8_t> visible(count, &frameArena);
+            simdMath::cullAABBs(frustum, { minX.data(), minY.data(), minZ.data(), maxX.data(), maxY.data(), maxZ.data(), count }, visible.data());
+
+            VkCommandBuffer commandBuffer = beginRecording();
+            uint32_t visibleCount = 0;
+
+            for (size_t i = 0; i < count; i++) {
+                if (visible[i]) {
+                    vkd.vkCmdDraw(commandBuffer, 3, 1, 0, 0);
+                    visibleCount++;
+                }
+            }
+
+            frameStats::drawsRecorded(visibleCount);
+            submitRecording(commandBuffer);
+            frameResourcesHandler.endFrame();
+
+            if (frame >= WARMUP_FRAMES) {
+                frameTimes.push_back(millisecondsSince(start));
+                visibleTotal += visibleCount;
+            }
+        }
+
+        vkd.vkDeviceWaitIdle(logicalDeviceHandler.device);
+
+        std::sort(frameTimes.begin(), frameTimes.end());
+
+        auto percentile = [&](double p) {
+            size_t index = static_cast<size_t>(p * (frameTimes.size() - 1));
+            return frameTimes[index];
+        };
+
+        double sum = 0.0;
+        for (double time : frameTimes) {
+            sum += time;
+        }
+
+        std::string prefix = std::string("scene.") + scene.name + ".";
+        results.add(prefix + "objects", count);
+        results.add(prefix + "visible_mean", visibleTotal / frameTimes.size());
+        results.add(prefix + "frame_ms_mean", sum / frameTimes.size());
+        results.add(prefix + "frame_ms_p50", percentile(0.50));
+        results.add(prefix + "frame_ms_p90", percentile(0.90));
+        results.add(prefix + "frame_ms_p99", percentile(0.99));
+        results.add(prefix + "frame_ms_max", frameTimes.back());
+    }
+
+    /// Host write into a staging buffer, then a copy into a device local buffer
+    void benchmarkUpload() {
+
+        VkPhysicalDevice physicalDevice = physicalDeviceHandler.physicalDevice;
+        VkDevice device = logicalDeviceHandler.device;
+
+        VkBuffer stagingBuffer, deviceBuffer;
+        VkDeviceMemory stagingMemory, deviceMemory;
+
+        bufferHandler.createBuffer(physicalDevice, device, UPLOAD_SIZE, VK_BUFFER_USAGE_TRANSFER_SRC_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, stagingBuffer, stagingMemory);
+        bufferHandler.createBuffer(physicalDevice, device, UPLOAD_SIZE, VK_BUFFER_USAGE_TRANSFER_DST_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, deviceBuffer, deviceMemory);
+
+        void* mapped;
+        if (vkd.vkMapMemory(device, stagingMemory, 0, UPLOAD_SIZE, 0, &mapped) != VK_SUCCESS) {
+            throw std::runtime_error("Failed to map benchmark staging memory!");
+        }
+
+        std::vector<uint8_t> source(UPLOAD_SIZE, 0xAB);
+
+        auto start = Clock::now();
+
+        for (uint32_t i = 0; i < UPLOAD_ITERATIONS; i++) {
+
+            frameResourcesHandler.beginFrame(device);
+
+            memcpy(mapped, source.data(), UPLOAD_SIZE);
+
+            VkCommandBuffer commandBuffer = frameResourcesHandler.allocateCommandBuffer(device);
+
+            VkCommandBufferBeginInfo beginInfo{};
+            beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+            beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+            vkd.vkBeginCommandBuffer(commandBuffer, &beginInfo);
+
+            VkBufferCopy copyRegion{};
+            copyRegion.size = UPLOAD_SIZE;
+            vkd.vkCmdCopyBuffer(commandBuffer, stagingBuffer, deviceBuffer, 1, &copyRegion);
+
+            vkd.vkEndCommandBuffer(commandBuffer);
+
+            VkSubmitInfo submitInfo{};
+            submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+            submitInfo.commandBufferCount = 1;
+            submitInfo.pCommandBuffers = &commandBuffer;
+
+            frameResourcesHandler.submit(device, logicalDeviceHandler.graphicsQueue, submitInfo);
+
+            /// The staging buffer is reused, so every upload has to finish before the next memcpy
+            vkd.vkDeviceWaitIdle(device);
+            frameResourcesHandler.endFrame();
+        }
+
+        double elapsedMs = millisecondsSince(start);
+        double megabytes = static_cast<double>(UPLOAD_SIZE) * UPLOAD_ITERATIONS / (1024.0 * 1024.0);
+
+        results.add("upload.megabytes_per_second", megabytes / (elapsedMs / 1000.0));
+
+        vkd.vkUnmapMemory(device, stagingMemory);
+        bufferHandler.destroyBuffer(device, stagingBuffer, stagingMemory);
+        bufferHandler.destroyBuffer(device, deviceBuffer, deviceMemory);
+    }
+
+    /// Records `DRAW_CALLS` draws into one command buffer, then submits and waits for them
+    void benchmarkDrawCalls() {
+
+        frameResourcesHandler.beginFrame(logicalDeviceHandler.device);
+
+        auto start = Clock::now();
+
+        VkCommandBuffer commandBuffer = beginRecording();
+
+        for (uint32_t i = 0; i < DRAW_CALLS; i++) {
+            vkd.vkCmdDraw(commandBuffer, 3, 1, 0, 0);
+        }
+
+        double recordMs = millisecondsSince(start);
+
+        frameStats::drawsRecorded(DRAW_CALLS);
+        submitRecording(commandBuffer);
+        vkd.vkDeviceWaitIdle(logicalDeviceHandler.device);
+
+        double totalMs = millisecondsSince(start);
+
+        frameResourcesHandler.endFrame();
+
+        results.add("draws.recorded_per_ms", DRAW_CALLS / recordMs);
+        results.add("draws.executed_per_ms", DRAW_CALLS / totalMs);
+    }
+
+    /// Records the same hot commands through the loader's exported trampolines and through `vkd`
+    /// Rounds alternate between the two and the fastest of each is kept, so warm up and noise affect both alike
+    /// The difference is the per call cost of the loader hop that the dispatch table removes
+    void benchmarkDispatch() {
+
+        auto loaderCmdBindPipeline = loaderExport<PFN_vkCmdBindPipeline>("vkCmdBindPipeline");
+        auto loaderCmdDraw = loaderExport<PFN_vkCmdDraw>("vkCmdDraw");
+
+        double loaderNs = std::numeric_limits<double>::max();
+        double directNs = std::numeric_limits<double>::max();
+
+        for (uint32_t round = 0; round < DISPATCH_ROUNDS; round++) {
+            loaderNs = std::min(loaderNs, recordDispatchRound(loaderCmdBindPipeline, loaderCmdDraw));
+            directNs = std::min(directNs, recordDispatchRound(vkd.vkCmdBindPipeline, vkd.vkCmdDraw));
+        }
+
+        results.add("dispatch.loader_ns_per_call", loaderNs);
+        results.add("dispatch.direct_ns_per_call", directNs);
+        results.add("dispatch.saved_ns_per_call", loaderNs - directNs);
+    }
+
+    /// An entry point exported by the loader library the benchmark links against
+    /// VK_NO_PROTOTYPES leaves them undeclared, so they are looked up by name
+    template <typename Function>
+    static Function loaderExport(const char* name) {
+
+        auto function = reinterpret_cast<Function>(dlsym(RTLD_DEFAULT, name));
+
+        if (function == nullptr) {
+            throw std::runtime_error(std::string("The Vulkan loader does not export ") + name + "!");
+        }
+
+        return function;
+    }
+
+    /// Nanoseconds per call for `DISPATCH_CALLS` commands, half pipeline binds and half draws
+    /// The command buffers are never submitted, `beginFrame` resets the pool they came from
+    double recordDispatchRound(PFN_vkCmdBindPipeline cmdBindPipeline, PFN_vkCmdDraw cmdDraw) {
+
+        frameResourcesHandler.beginFrame(logicalDeviceHandler.device);
+
+        VkCommandBuffer commandBuffer = beginRecording();
+
+        auto start = Clock::now();
+
+        for (uint32_t i = 0; i < DISPATCH_CALLS / 2; i++) {
+            cmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pipeline);
+            cmdDraw(commandBuffer, 3, 1, 0, 0);
+        }
+
+        double elapsedMs = millisecondsSince(start);
+
+        vkd.vkCmdEndRenderPass(commandBuffer);
+        vkd.vkEndCommandBuffer(commandBuffer);
+
+        frameResourcesHandler.endFrame();
+
+        return elapsedMs * 1e6 / DISPATCH_CALLS;
+    }
+
+    void cleanup() {
+        VkDevice device = logicalDeviceHandler.device;
+
+        frameResourcesHandler.cleanupFrameResources(device);
+        vkd.vkDestroyPipeline(device, pipeline, nullptr);
+        vkd.vkDestroyPipelineLayout(device, pipelineLayout, nullptr);
+        vkd.vkDestroyFramebuffer(device, framebuffer, nullptr);
+        vkd.vkDestroyRenderPass(device, renderPass, nullptr);
+        vkd.vkDestroyDevice(device, nullptr);
+        vkd.vkDestroyInstance(instance, nullptr);
+    }
+
+};
+
+
+int main(int argc, char** argv) {
+
+    std::string outputPath = argc > 1 ? argv[1] : "benchmark_results.json";
+
+    BenchmarkApplication app;
+
+    try {
+        app.run(outputPath);
+    } catch (const std::exception& e) {
+        std::cerr << e.what() << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    return EXIT_SUCCESS;
+}
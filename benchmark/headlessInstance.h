@@ -0,0 +1,60 @@
+/// Instance for the benchmark and the device tests
+/// No window system extensions, nothing built on it ever presents, so it runs on
+/// a software ICD (lavapipe) on a Linux machine without a display
+
+#ifndef headlessInstance_h
+#define headlessInstance_h
+
+#include "dispatchTable.h"
+#include <cstring>
+#include <stdexcept>
+#include <vector>
+
+/// Loads `vkd` as it goes, the returned instance is ready for `PhysicalDeviceHandler`
+inline VkInstance createHeadlessInstance(const char* applicationName) {
+
+    vkd.loadGlobal();
+
+    VkApplicationInfo appInfo{};
+    appInfo.sType = VK_STRUCTURE_TYPE_APPLICATION_INFO;
+    appInfo.pApplicationName = applicationName;
+    appInfo.applicationVersion = VK_MAKE_VERSION(1, 0, 0);
+    appInfo.pEngineName = "NO ENGINE";
+    appInfo.engineVersion = VK_MAKE_VERSION(1, 0, 0);
+    appInfo.apiVersion = VK_API_VERSION_1_0;
+
+    VkInstanceCreateInfo createInfo{};
+    createInfo.sType = VK_STRUCTURE_TYPE_INSTANCE_CREATE_INFO;
+    createInfo.pApplicationInfo = &appInfo;
+
+    /// Only ask for portability enumeration where the loader has it (macOS), Linux loaders may not
+    uint32_t extensionCount = 0;
+    vkd.vkEnumerateInstanceExtensionProperties(nullptr, &extensionCount, nullptr);
+
+    std::vector<VkExtensionProperties> extensions(extensionCount);
+    vkd.vkEnumerateInstanceExtensionProperties(nullptr, &extensionCount, extensions.data());
+
+    std::vector<const char*> requiredExtensions;
+
+    for (const auto& extension : extensions) {
+        if (strcmp(extension.extensionName, VK_KHR_PORTABILITY_ENUMERATION_EXTENSION_NAME) == 0) {
+            requiredExtensions.push_back(VK_KHR_PORTABILITY_ENUMERATION_EXTENSION_NAME);
+            createInfo.flags |= VK_INSTANCE_CREATE_ENUMERATE_PORTABILITY_BIT_KHR;
+        }
+    }
+
+    createInfo.enabledExtensionCount = static_cast<uint32_t>(requiredExtensions.size());
+    createInfo.ppEnabledExtensionNames = requiredExtensions.data();
+
+    VkInstance instance;
+
+    if (vkd.vkCreateInstance(&createInfo, nullptr, &instance) != VK_SUCCESS) {
+        throw std::runtime_error("Failed to create Instance!");
+    }
+
+    vkd.loadInstance(instance);
+
+    return instance;
+}
+
+#endif /* headlessInstance_h */
@@ -0,0 +1,250 @@
+/// Checks CompressedTextureHandler's KTX2 reader against a known file and damaged copies of it
+///
+/// fixtures/rgba8_8x8.ktx2 is VK_FORMAT_R8G8B8A8_UNORM, 8x8 with 4 levels and a linear DFD,
+/// every byte of level n is (n << 4) | (index & 0xF) so a level read from the wrong offset shows
+/// The damaged copies are made from it in memory, one header or index field at a time
+///
+/// Built with USE_BASISU_TRANSCODER it also transcodes ETC1S and UASTC files made by the
+/// basisu tool from fixtures/quadrants.png, four solid 8x8 quadrants on a 16x16 image
+///
+///   ktx2_test <fixture directory> [<generated fixture directory>]
+
+#include "compressedTextureHandler.h"
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <iterator>
+#include <string>
+
+namespace {
+
+    const uint32_t WIDTH = 8;
+    const uint32_t HEIGHT = 8;
+    const uint32_t LEVELS = 4;
+
+    /// Offsets into the fixture, from the KTX2 header layout
+    const size_t LEVEL_COUNT_OFFSET = 40;
+    const size_t FACE_COUNT_OFFSET = 36;
+    const size_t SUPERCOMPRESSION_OFFSET = 44;
+    const size_t DFD_OFFSET_OFFSET = 48;
+    const size_t LEVEL_INDEX_OFFSET = 80;
+    const size_t DFD_START = LEVEL_INDEX_OFFSET + LEVELS * 24;
+
+    int failures = 0;
+
+    void expect(const std::string& check, bool passed) {
+        if (!passed) {
+            printf("FAIL %s\n", check.c_str());
+            failures++;
+        }
+    }
+
+    std::vector<uint8_t> readFile(const std::string& path) {
+
+        std::ifstream stream(path, std::ios::binary);
+
+        if (!stream) {
+            throw std::runtime_error("Failed to open fixture " + path);
+        }
+
+        return std::vector<uint8_t>(std::istreambuf_iterator<char>(stream), std::istreambuf_iterator<char>());
+    }
+
+    void write32(std::vector<uint8_t>& bytes, size_t offset, uint32_t value) {
+        memcpy(bytes.data() + offset, &value, sizeof(value));
+    }
+
+    void write64(std::vector<uint8_t>& bytes, size_t offset, uint64_t value) {
+        memcpy(bytes.data() + offset, &value, sizeof(value));
+    }
+
+    uint64_t read64(const std::vector<uint8_t>& bytes, size_t offset) {
+        uint64_t value;
+        memcpy(&value, bytes.data() + offset, sizeof(value));
+        return value;
+    }
+
+    void checkValidFile(CompressedTextureHandler& handler, const std::string& path) {
+
+        CompressedTextureHandler::Ktx2File file = handler.loadKtx2(path);
+
+        expect("format is RGBA8", file.vkFormat == VK_FORMAT_R8G8B8A8_UNORM);
+        expect("size is 8x8", file.width == WIDTH && file.height == HEIGHT);
+        expect("4 levels", file.levelCount == LEVELS && file.levels.size() == LEVELS);
+        expect("not supercompressed", file.supercompressionScheme == CompressedTextureHandler::SUPERCOMPRESSION_NONE);
+        expect("linear transfer", !file.srgb);
+        expect("no transcoding", !file.needsTranscoding());
+
+        TextureStreamingHandler::TextureSource source = handler.makeStreamingSource(file, file.vkFormat);
+
+        expect("source matches the file", source.width == WIDTH && source.height == HEIGHT && source.mipLevels == LEVELS && source.format == file.vkFormat);
+
+        for (uint32_t level = 0; level < LEVELS; level++) {
+
+            std::vector<uint8_t> bytes = source.loadMip(level);
+            uint32_t size = std::max(1u, WIDTH >> level) * std::max(1u, HEIGHT >> level) * 4;
+
+            expect("level " + std::to_string(level) + " size", bytes.size() == size);
+
+            bool contents = true;
+
+            for (size_t i = 0; i < bytes.size(); i++) {
+                contents &= bytes[i] == ((level << 4) | (i & 0xF));
+            }
+
+            expect("level " + std::to_string(level) + " contents", contents);
+        }
+    }
+
+    /// Writes a damaged copy of the fixture and expects loadKtx2 to reject it with `message`
+    void checkRejected(CompressedTextureHandler& handler, const std::vector<uint8_t>& valid, const char* name, const char* message, const std::function<void(std::vector<uint8_t>&)>& damage) {
+
+        std::vector<uint8_t> bytes = valid;
+        damage(bytes);
+
+        std::string path = (std::filesystem::temp_directory_path() / (std::string("ktx2_test_") + name + ".ktx2")).string();
+
+        {
+            std::ofstream stream(path, std::ios::binary | std::ios::trunc);
+            stream.write(reinterpret_cast<const char*>(bytes.data()), bytes.size());
+        }
+
+        try {
+            handler.loadKtx2(path);
+            expect(std::string(name) + " is rejected", false);
+        } catch (const std::runtime_error& e) {
+            expect(std::string(name) + " is rejected with \"" + message + "\", got \"" + e.what() + "\"", strstr(e.what(), message) != nullptr);
+        }
+
+        std::filesystem::remove(path);
+    }
+
+    void checkDamagedFiles(CompressedTextureHandler& handler, const std::vector<uint8_t>& valid) {
+
+        checkRejected(handler, valid, "empty", "is not a KTX2 file", [](auto& bytes) { bytes.clear(); });
+        checkRejected(handler, valid, "truncated_header", "is not a KTX2 file", [](auto& bytes) { bytes.resize(LEVEL_INDEX_OFFSET - 1); });
+        checkRejected(handler, valid, "bad_identifier", "is not a KTX2 file", [](auto& bytes) { bytes[5] = '1'; });
+
+        checkRejected(handler, valid, "cube", "is not a plain 2D texture", [](auto& bytes) { write32(bytes, FACE_COUNT_OFFSET, 6); });
+        checkRejected(handler, valid, "zero_width", "is not a plain 2D texture", [](auto& bytes) { write32(bytes, 20, 0); });
+        checkRejected(handler, valid, "too_many_levels", "has more levels than its size allows", [](auto& bytes) { write32(bytes, LEVEL_COUNT_OFFSET, LEVELS + 1); });
+        checkRejected(handler, valid, "huge_level_count", "has more levels than its size allows", [](auto& bytes) { write32(bytes, LEVEL_COUNT_OFFSET, 0xFFFFFFFF); });
+        checkRejected(handler, valid, "zstd_rgba8", "unsupported supercompression scheme", [](auto& bytes) { write32(bytes, SUPERCOMPRESSION_OFFSET, CompressedTextureHandler::SUPERCOMPRESSION_ZSTD); });
+        checkRejected(handler, valid, "unknown_format", "format the streamer does not support", [](auto& bytes) { write32(bytes, 12, VK_FORMAT_R8G8B8_UNORM); });
+
+        checkRejected(handler, valid, "dfd_past_end", "truncated data format descriptor", [](auto& bytes) { write32(bytes, DFD_OFFSET_OFFSET, 0xFFFFFFF0); });
+        checkRejected(handler, valid, "dfd_cut_off", "truncated data format descriptor", [](auto& bytes) { bytes.resize(DFD_START + 8); write32(bytes, DFD_OFFSET_OFFSET, DFD_START); });
+
+        /// The DFD is pointed into the level index so the file can end inside the index
+        checkRejected(handler, valid, "truncated_level_index", "truncated level index", [](auto& bytes) {
+            write32(bytes, DFD_OFFSET_OFFSET, LEVEL_INDEX_OFFSET);
+            bytes.resize(DFD_START - 1);
+        });
+
+        checkRejected(handler, valid, "level_past_end", "level outside of the file", [](auto& bytes) { write64(bytes, LEVEL_INDEX_OFFSET, bytes.size() + 1); });
+        checkRejected(handler, valid, "level_wraps", "level outside of the file", [](auto& bytes) { write64(bytes, LEVEL_INDEX_OFFSET + 8, 0xFFFFFFFFFFFFFF00ull); });
+        checkRejected(handler, valid, "truncated_level", "level outside of the file", [](auto& bytes) { bytes.resize(read64(bytes, LEVEL_INDEX_OFFSET) + 1); });
+        checkRejected(handler, valid, "short_level", "level of the wrong size", [](auto& bytes) { write64(bytes, LEVEL_INDEX_OFFSET + 24 + 8, read64(bytes, LEVEL_INDEX_OFFSET + 24 + 8) - 4); });
+
+        try {
+            handler.loadKtx2("does_not_exist.ktx2");
+            expect("missing file is rejected", false);
+        } catch (const std::runtime_error&) {}
+    }
+
+#ifdef USE_BASISU_TRANSCODER
+    /// Color of each quadrant of quadrants.png, left to right then top to bottom
+    const uint8_t QUADRANT_COLORS[4][4] = {
+        { 255, 0, 0, 255 },
+        { 0, 255, 0, 255 },
+        { 0, 0, 255, 255 },
+        { 255, 255, 255, 255 },
+    };
+
+    /// ETC1S is lossy, solid blocks still come back close to their color
+    const int COLOR_TOLERANCE = 32;
+
+    void checkTranscoding(CompressedTextureHandler& handler, const std::string& path, const char* name) {
+
+        CompressedTextureHandler::Ktx2File file = handler.loadKtx2(path);
+
+        expect(std::string(name) + " needs transcoding", file.needsTranscoding());
+        expect(std::string(name) + " has the full chain", file.width == 16 && file.height == 16 && file.levelCount == 5);
+
+        TextureStreamingHandler::TextureSource rgba = handler.makeStreamingSource(file, VK_FORMAT_R8G8B8A8_UNORM);
+
+        std::vector<uint8_t> pixels = rgba.loadMip(0);
+        expect(std::string(name) + " RGBA level 0 size", pixels.size() == 16 * 16 * 4);
+
+        for (uint32_t quadrant = 0; quadrant < 4 && pixels.size() == 16 * 16 * 4; quadrant++) {
+
+            /// Center of the quadrant, away from the block edges between colors
+            uint32_t x = (quadrant % 2) * 8 + 4;
+            uint32_t y = (quadrant / 2) * 8 + 4;
+            const uint8_t* pixel = &pixels[(y * 16 + x) * 4];
+
+            bool close = true;
+
+            for (int channel = 0; channel < 4; channel++) {
+                close &= std::abs(pixel[channel] - QUADRANT_COLORS[quadrant][channel]) <= COLOR_TOLERANCE;
+            }
+
+            expect(std::string(name) + " quadrant " + std::to_string(quadrant) + " color", close);
+        }
+
+        expect(std::string(name) + " RGBA last level size", rgba.loadMip(4).size() == 4);
+
+        /// Block formats are sized in blocks, a 16x16 BC7 level is 4x4 blocks of 16 bytes
+        TextureStreamingHandler::TextureSource bc7 = handler.makeStreamingSource(file, VK_FORMAT_BC7_UNORM_BLOCK);
+
+        expect(std::string(name) + " BC7 level 0 size", bc7.loadMip(0).size() == 4 * 4 * 16);
+        expect(std::string(name) + " BC7 last level size", bc7.loadMip(4).size() == 16);
+    }
+#endif
+
+}
+
+int main(int argc, char** argv) {
+
+    if (argc < 2) {
+        printf("usage: %s <fixture directory> [<generated fixture directory>]\n", argv[0]);
+        return 1;
+    }
+
+    std::string fixtures = argv[1];
+    CompressedTextureHandler handler;
+
+    try {
+        std::string validPath = fixtures + "/rgba8_8x8.ktx2";
+
+        checkValidFile(handler, validPath);
+        checkDamagedFiles(handler, readFile(validPath));
+
+#ifdef USE_BASISU_TRANSCODER
+        if (argc < 3) {
+            printf("FAIL built with USE_BASISU_TRANSCODER but no generated fixture directory given\n");
+            return 1;
+        }
+
+        std::string generated = argv[2];
+
+        checkTranscoding(handler, generated + "/quadrants_etc1s.ktx2", "ETC1S");
+        checkTranscoding(handler, generated + "/quadrants_uastc.ktx2", "UASTC");
+#endif
+    } catch (const std::exception& e) {
+        printf("FAIL %s\n", e.what());
+        return 1;
+    }
+
+    if (failures != 0) {
+        printf("%d checks failed\n", failures);
+        return 1;
+    }
+
+    printf("All checks passed\n");
+    return 0;
+}
@@ -0,0 +1,30 @@
+/// Vertex shader for the benchmark and the device tests, `gl_Position = vec4(0.0)`
+/// Assembled by hand so nothing here needs a shader compiler
+/// Pipelines using it discard rasterization, so no fragment shader is needed and only the vertex stage runs
+
+#ifndef nullVertexShader_h
+#define nullVertexShader_h
+
+#include <cstdint>
+
+inline constexpr uint32_t NULL_VERTEX_SHADER[] = {
+    0x07230203, 0x00010000, 0x00000000, 10, 0,
+    (2 << 16) | 17, 1,                                  /// OpCapability Shader
+    (3 << 16) | 14, 0, 1,                               /// OpMemoryModel Logical GLSL450
+    (6 << 16) | 15, 0, 1, 0x6E69616D, 0x00000000, 2,    /// OpEntryPoint Vertex %1 "main" %2
+    (4 << 16) | 71, 2, 11, 0,                           /// OpDecorate %2 BuiltIn Position
+    (2 << 16) | 19, 3,                                  /// %3 = OpTypeVoid
+    (3 << 16) | 33, 4, 3,                               /// %4 = OpTypeFunction %3
+    (3 << 16) | 22, 5, 32,                              /// %5 = OpTypeFloat 32
+    (4 << 16) | 23, 6, 5, 4,                            /// %6 = OpTypeVector %5 4
+    (4 << 16) | 32, 7, 3, 6,                            /// %7 = OpTypePointer Output %6
+    (4 << 16) | 59, 7, 2, 3,                            /// %2 = OpVariable %7 Output
+    (3 << 16) | 46, 6, 8,                               /// %8 = OpConstantNull %6
+    (5 << 16) | 54, 3, 1, 0, 4,                         /// %1 = OpFunction %3 None %4
+    (2 << 16) | 248, 9,                                 /// %9 = OpLabel
+    (3 << 16) | 62, 2, 8,                               /// OpStore %2 %8
+    (1 << 16) | 253,                                    /// OpReturn
+    (1 << 16) | 56,                                     /// OpFunctionEnd
+};
+
+#endif /* nullVertexShader_h */
@@ -0,0 +1,370 @@
+/// Runs ShaderHandler's hot reload on a real device
+/// The "compiler" copies the source to the output, so the watched source holds SPIR-V
+/// and the test needs no glslc
+///
+/// Rewrites the watched source and checks that the pipeline handle is swapped at the start
+/// of a frame, and that the old pipeline is only destroyed once MAX_FRAMES_IN_FLIGHT frames
+/// have started since. Then makes the rebuild fail and checks that the SPIR-V on disk and
+/// the bound pipeline are left as they were
+
+#include "physicalDeviceHandler.hpp"
+#include "logicalDeviceHandler.h"
+#include "frameResourcesHandler.h"
+#include "shaderHandler.h"
+#include "headlessInstance.h"
+#include "nullVertexShader.h"
+
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <thread>
+#include <vector>
+
+#include <unistd.h>
+
+namespace {
+
+    /// Frames to wait for the watcher thread before a reload counts as stuck, 10 ms each
+    const uint32_t MAX_FRAMES = 500;
+
+    int failures = 0;
+
+    void expect(const char* check, bool passed) {
+        if (!passed) {
+            printf("FAIL %s\n", check);
+            failures++;
+        }
+    }
+
+    int64_t livePipelines() {
+        return frameStats::liveObjects[static_cast<size_t>(frameStats::ObjectType::Pipeline)];
+    }
+
+    int64_t liveShaderModules() {
+        return frameStats::liveObjects[static_cast<size_t>(frameStats::ObjectType::ShaderModule)];
+    }
+
+    std::vector<uint32_t> nullVertexShader() {
+        return std::vector<uint32_t>(std::begin(NULL_VERTEX_SHADER), std::end(NULL_VERTEX_SHADER));
+    }
+
+    /// The same shader with an `OpSource Unknown 0` in its debug section, so the file differs
+    std::vector<uint32_t> editedVertexShader() {
+
+        std::vector<uint32_t> words = nullVertexShader();
+
+        /// Header (5 words), OpCapability (2), OpMemoryModel (3) and OpEntryPoint (6)
+        const size_t debugSection = 5 + 2 + 3 + 6;
+        words.insert(words.begin() + debugSection, { (3 << 16) | 3, 0, 0 });
+
+        return words;
+    }
+
+    std::vector<char> readFile(const std::filesystem::path& path) {
+        std::ifstream stream(path, std::ios::binary);
+        return std::vector<char>(std::istreambuf_iterator<char>(stream), std::istreambuf_iterator<char>());
+    }
+
+    bool fileHolds(const std::filesystem::path& path, const std::vector<uint32_t>& words) {
+
+        std::vector<char> bytes = readFile(path);
+
+        return bytes.size() == words.size() * sizeof(uint32_t) && memcmp(bytes.data(), words.data(), bytes.size()) == 0;
+    }
+
+    /// Saves the way editors often do, a new file renamed over the old one
+    /// The time is moved forward so the change shows even on a coarse file system clock
+    void saveSource(const std::filesystem::path& path, const std::vector<uint32_t>& words) {
+
+        std::filesystem::path saved = path.string() + ".save";
+
+        {
+            std::ofstream stream(saved, std::ios::binary | std::ios::trunc);
+            stream.write(reinterpret_cast<const char*>(words.data()), words.size() * sizeof(uint32_t));
+        }
+
+        auto previous = std::filesystem::exists(path) ? std::filesystem::last_write_time(path) : std::filesystem::file_time_type::clock::now();
+        std::filesystem::last_write_time(saved, previous + std::chrono::seconds(1));
+        std::filesystem::rename(saved, path);
+    }
+
+    class ReloadScene {
+
+        VkInstance instance;
+        PhysicalDeviceHandler physicalDeviceHandler;
+        LogicalDeviceHandler logicalDeviceHandler;
+        FrameResourcesHandler frameResourcesHandler;
+        ShaderHandler shaderHandler;
+
+        VkRenderPass renderPass;
+        VkFramebuffer framebuffer;
+        VkPipelineLayout pipelineLayout;
+
+        std::filesystem::path directory;
+        std::filesystem::path sourcePath;
+        std::filesystem::path spirvPath;
+
+        ShaderHandler::PipelineId pipelineId;
+
+        /// Set by the test, read by the builder on the watcher thread
+        std::atomic<bool> failBuilds{false};
+        std::atomic<uint32_t> buildAttempts{0};
+
+    public:
+
+        void run() {
+
+            instance = createHeadlessInstance("ShaderReloadTest");
+            physicalDeviceHandler.pickPhysicalDevice(instance, {});
+            logicalDeviceHandler.createLogicalDevice(physicalDeviceHandler.physicalDevice, {});
+            frameResourcesHandler.createFrameResources(physicalDeviceHandler.physicalDevice, logicalDeviceHandler.device, logicalDeviceHandler.queueFamilyIndices.graphicsFamily.value());
+            createRenderPass();
+
+            directory = std::filesystem::temp_directory_path() / ("shader_reload_test_" + std::to_string(getpid()));
+            std::filesystem::create_directories(directory);
+            sourcePath = directory / "null.vert";
+            spirvPath = directory / "null.vert.spv";
+
+            saveSource(sourcePath, nullVertexShader());
+            std::filesystem::copy_file(sourcePath, spirvPath);
+
+            /// Invoked as `<command> <source> -o <spirv>`, so $0 is the source and $2 the output
+            shaderHandler.compilerCommand = "sh -c 'cp \"$0\" \"$2\"'";
+            shaderHandler.createShaderHandler(logicalDeviceHandler.device);
+
+            ShaderHandler::ShaderId shaderId = shaderHandler.loadShader(spirvPath.string(), sourcePath.string());
+            pipelineId = shaderHandler.createPipeline({ shaderId }, [this](VkDevice device, const std::vector<VkShaderModule>& modules) {
+                return buildPipeline(device, modules[0]);
+            });
+
+            shaderHandler.startHotReload();
+
+            checkReload();
+            checkFailedReload();
+
+            shaderHandler.cleanupShaderHandler(logicalDeviceHandler.device);
+
+            expect("every pipeline was destroyed", livePipelines() == 0);
+            expect("every shader module was destroyed", liveShaderModules() == 0);
+
+            vkd.vkDestroyFramebuffer(logicalDeviceHandler.device, framebuffer, nullptr);
+            vkd.vkDestroyPipelineLayout(logicalDeviceHandler.device, pipelineLayout, nullptr);
+            vkd.vkDestroyRenderPass(logicalDeviceHandler.device, renderPass, nullptr);
+            frameResourcesHandler.cleanupFrameResources(logicalDeviceHandler.device);
+            logicalDeviceHandler.destroyLogicalDevice();
+            vkd.vkDestroyInstance(instance, nullptr);
+
+            std::filesystem::remove_all(directory);
+        }
+
+    private:
+
+        void checkReload() {
+
+            VkPipeline original = shaderHandler.pipeline(pipelineId);
+            int64_t pipelinesBefore = livePipelines();
+
+            saveSource(sourcePath, editedVertexShader());
+
+            bool swapped = false;
+
+            for (uint32_t i = 0; i < MAX_FRAMES && !swapped; i++) {
+                frame();
+                swapped = shaderHandler.pipeline(pipelineId) != original;
+            }
+
+            expect("the pipeline is swapped after the source changes", swapped);
+            expect("the new SPIR-V replaced the old file", fileHolds(spirvPath, editedVertexShader()));
+            expect("no compiler output is left behind", !std::filesystem::exists(spirvPath.string() + ".reload"));
+
+            /// The frame that swapped retired the old pipeline, frames still in flight may use it
+            for (uint32_t i = 1; i < FrameResourcesHandler::MAX_FRAMES_IN_FLIGHT; i++) {
+                frame();
+                expect("the old pipeline lives while frames in flight may use it", livePipelines() == pipelinesBefore + 1);
+            }
+
+            frame();
+            expect("the old pipeline is destroyed MAX_FRAMES_IN_FLIGHT frames after the swap", livePipelines() == pipelinesBefore);
+        }
+
+        void checkFailedReload() {
+
+            VkPipeline current = shaderHandler.pipeline(pipelineId);
+            int64_t pipelinesBefore = livePipelines();
+            int64_t modulesBefore = liveShaderModules();
+            uint32_t attemptsBefore = buildAttempts;
+
+            failBuilds = true;
+            saveSource(sourcePath, nullVertexShader());
+
+            /// The compiler output is removed after the builder throws, wait for both
+            bool attempted = false;
+
+            for (uint32_t i = 0; i < MAX_FRAMES && !attempted; i++) {
+                frame();
+                attempted = buildAttempts != attemptsBefore && !std::filesystem::exists(spirvPath.string() + ".reload");
+            }
+
+            for (uint32_t i = 0; i < FrameResourcesHandler::MAX_FRAMES_IN_FLIGHT; i++) {
+                frame();
+            }
+
+            expect("the failing rebuild ran", attempted);
+            expect("a failed rebuild keeps the bound pipeline", shaderHandler.pipeline(pipelineId) == current);
+            expect("a failed rebuild leaves the SPIR-V file alone", fileHolds(spirvPath, editedVertexShader()));
+            expect("a failed rebuild leaks no pipeline", livePipelines() == pipelinesBefore);
+            expect("a failed rebuild leaks no shader module", liveShaderModules() == modulesBefore);
+
+            failBuilds = false;
+        }
+
+        /// One frame the way the renderer drives it, the pipeline is bound and drawn with
+        void frame() {
+
+            VkDevice device = logicalDeviceHandler.device;
+
+            frameResourcesHandler.beginFrame(device);
+            shaderHandler.applyReloads();
+
+            VkCommandBuffer commandBuffer = frameResourcesHandler.allocateCommandBuffer(device);
+
+            VkCommandBufferBeginInfo beginInfo{};
+            beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+            beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+            vkd.vkBeginCommandBuffer(commandBuffer, &beginInfo);
+
+            VkRenderPassBeginInfo renderPassInfo{};
+            renderPassInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO;
+            renderPassInfo.renderPass = renderPass;
+            renderPassInfo.framebuffer = framebuffer;
+            renderPassInfo.renderArea.extent = { 1, 1 };
+
+            vkd.vkCmdBeginRenderPass(commandBuffer, &renderPassInfo, VK_SUBPASS_CONTENTS_INLINE);
+            vkd.vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, shaderHandler.pipeline(pipelineId));
+            vkd.vkCmdDraw(commandBuffer, 3, 1, 0, 0);
+            vkd.vkCmdEndRenderPass(commandBuffer);
+
+            vkd.vkEndCommandBuffer(commandBuffer);
+
+            VkSubmitInfo submitInfo{};
+            submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+            submitInfo.commandBufferCount = 1;
+            submitInfo.pCommandBuffers = &commandBuffer;
+
+            frameResourcesHandler.submit(device, logicalDeviceHandler.graphicsQueue, submitInfo);
+            frameResourcesHandler.endFrame();
+
+            /// Gives the watcher thread time to notice the change and rebuild
+            std::this_thread::sleep_for(std::chrono::milliseconds(10));
+        }
+
+        /// A render pass without attachments, like the benchmark's
+        void createRenderPass() {
+
+            VkDevice device = logicalDeviceHandler.device;
+
+            VkSubpassDescription subpass{};
+            subpass.pipelineBindPoint = VK_PIPELINE_BIND_POINT_GRAPHICS;
+
+            VkRenderPassCreateInfo renderPassInfo{};
+            renderPassInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_CREATE_INFO;
+            renderPassInfo.subpassCount = 1;
+            renderPassInfo.pSubpasses = &subpass;
+
+            if (vkd.vkCreateRenderPass(device, &renderPassInfo, nullptr, &renderPass) != VK_SUCCESS) {
+                throw std::runtime_error("Failed to create render pass!");
+            }
+
+            VkFramebufferCreateInfo framebufferInfo{};
+            framebufferInfo.sType = VK_STRUCTURE_TYPE_FRAMEBUFFER_CREATE_INFO;
+            framebufferInfo.renderPass = renderPass;
+            framebufferInfo.width = 1;
+            framebufferInfo.height = 1;
+            framebufferInfo.layers = 1;
+
+            if (vkd.vkCreateFramebuffer(device, &framebufferInfo, nullptr, &framebuffer) != VK_SUCCESS) {
+                throw std::runtime_error("Failed to create framebuffer!");
+            }
+
+            VkPipelineLayoutCreateInfo layoutInfo{};
+            layoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+
+            if (vkd.vkCreatePipelineLayout(device, &layoutInfo, nullptr, &pipelineLayout) != VK_SUCCESS) {
+                throw std::runtime_error("Failed to create pipeline layout!");
+            }
+        }
+
+        /// Runs on the watcher thread during a reload, so it only creates the pipeline
+        VkPipeline buildPipeline(VkDevice device, VkShaderModule vertexShader) {
+
+            buildAttempts++;
+
+            if (failBuilds) {
+                throw std::runtime_error("Pipeline build failed on purpose!");
+            }
+
+            VkPipelineShaderStageCreateInfo stageInfo{};
+            stageInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+            stageInfo.stage = VK_SHADER_STAGE_VERTEX_BIT;
+            stageInfo.module = vertexShader;
+            stageInfo.pName = "main";
+
+            VkPipelineVertexInputStateCreateInfo vertexInput{};
+            vertexInput.sType = VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO;
+
+            VkPipelineInputAssemblyStateCreateInfo inputAssembly{};
+            inputAssembly.sType = VK_STRUCTURE_TYPE_PIPELINE_INPUT_ASSEMBLY_STATE_CREATE_INFO;
+            inputAssembly.topology = VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST;
+
+            VkPipelineRasterizationStateCreateInfo rasterizer{};
+            rasterizer.sType = VK_STRUCTURE_TYPE_PIPELINE_RASTERIZATION_STATE_CREATE_INFO;
+            rasterizer.rasterizerDiscardEnable = VK_TRUE;
+            rasterizer.polygonMode = VK_POLYGON_MODE_FILL;
+            rasterizer.lineWidth = 1.0f;
+
+            VkGraphicsPipelineCreateInfo pipelineInfo{};
+            pipelineInfo.sType = VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_CREATE_INFO;
+            pipelineInfo.stageCount = 1;
+            pipelineInfo.pStages = &stageInfo;
+            pipelineInfo.pVertexInputState = &vertexInput;
+            pipelineInfo.pInputAssemblyState = &inputAssembly;
+            pipelineInfo.pRasterizationState = &rasterizer;
+            pipelineInfo.layout = pipelineLayout;
+            pipelineInfo.renderPass = renderPass;
+            pipelineInfo.subpass = 0;
+
+            VkPipeline pipeline;
+
+            if (vkd.vkCreateGraphicsPipelines(device, VK_NULL_HANDLE, 1, &pipelineInfo, nullptr, &pipeline) != VK_SUCCESS) {
+                throw std::runtime_error("Failed to create graphics pipeline!");
+            }
+
+            return pipeline;
+        }
+    };
+
+}
+
+int main() {
+
+    ReloadScene scene;
+
+    try {
+        scene.run();
+    } catch (const std::exception& e) {
+        printf("FAIL %s\n", e.what());
+        return 1;
+    }
+
+    if (failures != 0) {
+        printf("%d checks failed\n", failures);
+        return 1;
+    }
+
+    printf("All checks passed\n");
+    return 0;
+}
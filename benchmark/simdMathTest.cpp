@@ -0,0 +1,169 @@
+/// Checks every simdMath SIMD path is bit-exact against simdMath::scalar
+/// Built next to the benchmark so it gets the same `-ffp-contract=off`, run through ctest
+///
+/// Batch sizes cover the empty batch, tails shorter than the widest register
+/// and sizes that are not a multiple of it, and every call is also made with
+/// its output aliasing its input
+
+#include "simdMath.h"
+#include <cstdio>
+#include <cstring>
+#include <random>
+#include <vector>
+
+namespace {
+
+    const size_t BATCH_SIZES[] = { 0, 1, 2, 3, 4, 5, 7, 8, 9, 15, 16, 17, 31, 33, 1000, 1027 };
+
+    std::mt19937 rng(1234);
+
+    int failures = 0;
+
+    float randomFloat() {
+        return std::uniform_real_distribution<float>(-100.0f, 100.0f)(rng);
+    }
+
+    simdMath::Mat4 randomMat4() {
+        simdMath::Mat4 matrix;
+
+        for (float& value : matrix.m) {
+            value = randomFloat();
+        }
+
+        return matrix;
+    }
+
+    std::vector<float> randomFloats(size_t count) {
+        std::vector<float> values(count);
+
+        for (float& value : values) {
+            value = randomFloat();
+        }
+
+        return values;
+    }
+
+    /// memcmp rather than ==, so -0.0f against 0.0f or differing NaNs are caught as well
+    void expectSame(const char* test, size_t count, const void* simd, const void* scalar, size_t bytes) {
+        if (bytes != 0 && memcmp(simd, scalar, bytes) != 0) {
+            printf("FAIL %s, count %zu\n", test, count);
+            failures++;
+        }
+    }
+
+    void testMultiply() {
+        for (int i = 0; i < 1000; i++) {
+            const simdMath::Mat4 a = randomMat4();
+            const simdMath::Mat4 b = randomMat4();
+
+            simdMath::Mat4 simd, scalar;
+            simdMath::multiply(a, b, simd);
+            simdMath::scalar::multiply(a, b, scalar);
+            expectSame("multiply", 1, &simd, &scalar, sizeof(simdMath::Mat4));
+
+            /// out aliasing a, then b
+            simdMath::Mat4 aliasA = a;
+            simdMath::multiply(aliasA, b, aliasA);
+            expectSame("multiply out == a", 1, &aliasA, &scalar, sizeof(simdMath::Mat4));
+
+            simdMath::Mat4 aliasB = b;
+            simdMath::multiply(a, aliasB, aliasB);
+            expectSame("multiply out == b", 1, &aliasB, &scalar, sizeof(simdMath::Mat4));
+        }
+    }
+
+    void testMultiplyBatch() {
+        for (size_t count : BATCH_SIZES) {
+            const simdMath::Mat4 parent = randomMat4();
+
+            std::vector<simdMath::Mat4> locals(count);
+
+            for (simdMath::Mat4& local : locals) {
+                local = randomMat4();
+            }
+
+            std::vector<simdMath::Mat4> simd(count), scalar(count);
+            simdMath::multiplyBatch(parent, locals.data(), simd.data(), count);
+
+            for (size_t i = 0; i < count; i++) {
+                simdMath::scalar::multiply(parent, locals[i], scalar[i]);
+            }
+
+            expectSame("multiplyBatch", count, simd.data(), scalar.data(), count * sizeof(simdMath::Mat4));
+
+            /// Updated in place
+            simdMath::multiplyBatch(parent, locals.data(), locals.data(), count);
+            expectSame("multiplyBatch out == locals", count, locals.data(), scalar.data(), count * sizeof(simdMath::Mat4));
+        }
+    }
+
+    void testTransformPoints() {
+        for (size_t count : BATCH_SIZES) {
+            const simdMath::Mat4 transform = randomMat4();
+
+            std::vector<float> inX = randomFloats(count), inY = randomFloats(count), inZ = randomFloats(count);
+            std::vector<float> simdX(count), simdY(count), simdZ(count);
+            std::vector<float> scalarX(count), scalarY(count), scalarZ(count);
+
+            simdMath::transformPoints(transform, inX.data(), inY.data(), inZ.data(), { simdX.data(), simdY.data(), simdZ.data(), count });
+            simdMath::scalar::transformPoints(transform, inX.data(), inY.data(), inZ.data(), { scalarX.data(), scalarY.data(), scalarZ.data(), count }, 0);
+
+            expectSame("transformPoints x", count, simdX.data(), scalarX.data(), count * sizeof(float));
+            expectSame("transformPoints y", count, simdY.data(), scalarY.data(), count * sizeof(float));
+            expectSame("transformPoints z", count, simdZ.data(), scalarZ.data(), count * sizeof(float));
+
+            /// Transformed in place
+            simdMath::transformPoints(transform, inX.data(), inY.data(), inZ.data(), { inX.data(), inY.data(), inZ.data(), count });
+
+            expectSame("transformPoints in place x", count, inX.data(), scalarX.data(), count * sizeof(float));
+            expectSame("transformPoints in place y", count, inY.data(), scalarY.data(), count * sizeof(float));
+            expectSame("transformPoints in place z", count, inZ.data(), scalarZ.data(), count * sizeof(float));
+        }
+    }
+
+    void testCullAABBs() {
+        for (size_t count : BATCH_SIZES) {
+            simdMath::Frustum frustum;
+
+            for (simdMath::Plane& plane : frustum.planes) {
+                plane = { randomFloat(), randomFloat(), randomFloat(), randomFloat() * 50.0f };
+            }
+
+            std::vector<float> minX = randomFloats(count), minY = randomFloats(count), minZ = randomFloats(count);
+            std::vector<float> maxX(count), maxY(count), maxZ(count);
+
+            for (size_t i = 0; i < count; i++) {
+                maxX[i] = minX[i] + 10.0f;
+                maxY[i] = minY[i] + 10.0f;
+                maxZ[i] = minZ[i] + 10.0f;
+            }
+
+            const simdMath::AABBsSoA boxes{ minX.data(), minY.data(), minZ.data(), maxX.data(), maxY.data(), maxZ.data(), count };
+
+            std::vector<uint8_t> simd(count), scalar(count);
+            simdMath::cullAABBs(frustum, boxes, simd.data());
+            simdMath::scalar::cullAABBs(frustum, boxes, scalar.data(), 0);
+
+            expectSame("cullAABBs", count, simd.data(), scalar.data(), count);
+        }
+    }
+
+}
+
+int main() {
+
+    printf("simdMath backend: %s\n", simdMath::backendName());
+
+    testMultiply();
+    testMultiplyBatch();
+    testTransformPoints();
+    testCullAABBs();
+
+    if (failures != 0) {
+        printf("%d checks failed\n", failures);
+        return 1;
+    }
+
+    printf("All checks passed\n");
+    return 0;
+}
@@ -0,0 +1,192 @@
+/// Runs TextureStreamingHandler through a scripted scene on a real device
+/// The textures are synthetic, their levels are generated on the streaming thread,
+/// and the budget only holds about two of the three at full resolution
+///
+/// Checks that the resident set never goes over the budget, that levels are taken
+/// from the least recently used texture first, and that evicted levels are streamed
+/// in again once their texture is used at full size again
+
+#include "physicalDeviceHandler.hpp"
+#include "logicalDeviceHandler.h"
+#include "frameResourcesHandler.h"
+#include "textureStreamingHandler.h"
+#include "headlessInstance.h"
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <initializer_list>
+#include <thread>
+
+namespace {
+
+    const uint32_t TEXTURE_SIZE = 256;
+    const uint32_t MIP_LEVELS = 9;
+    const uint32_t TEXTURE_COUNT = 3;
+
+    /// A full 256x256 RGBA8 chain is 349524 bytes, two fit and three do not,
+    /// and dropping one level 0 (262144 bytes) makes the third fit
+    const VkDeviceSize BUDGET = 800 * 1024;
+
+    /// Frames to wait for the streaming thread before a phase counts as stuck
+    const uint32_t MAX_FRAMES = 1000;
+
+    int failures = 0;
+
+    void expect(const char* check, bool passed) {
+        if (!passed) {
+            printf("FAIL %s\n", check);
+            failures++;
+        }
+    }
+
+    class StreamingScene {
+
+        VkInstance instance;
+        PhysicalDeviceHandler physicalDeviceHandler;
+        LogicalDeviceHandler logicalDeviceHandler;
+        FrameResourcesHandler frameResourcesHandler;
+        TextureStreamingHandler textureStreamingHandler;
+
+        /// How often each level of each texture was read, written on the streaming thread
+        std::array<std::array<std::atomic<uint32_t>, MIP_LEVELS>, TEXTURE_COUNT> loads{};
+
+        std::array<TextureStreamingHandler::TextureId, TEXTURE_COUNT> ids;
+
+        bool overBudget = false;
+
+    public:
+
+        void run() {
+
+            instance = createHeadlessInstance("TextureStreamingTest");
+            physicalDeviceHandler.pickPhysicalDevice(instance, {});
+            logicalDeviceHandler.createLogicalDevice(physicalDeviceHandler.physicalDevice, {});
+            frameResourcesHandler.createFrameResources(physicalDeviceHandler.physicalDevice, logicalDeviceHandler.device, logicalDeviceHandler.queueFamilyIndices.graphicsFamily.value());
+            textureStreamingHandler.createTextureStreaming(physicalDeviceHandler.physicalDevice, logicalDeviceHandler.device, BUDGET);
+
+            for (uint32_t i = 0; i < TEXTURE_COUNT; i++) {
+                ids[i] = textureStreamingHandler.registerTexture({ TEXTURE_SIZE, TEXTURE_SIZE, MIP_LEVELS, VK_FORMAT_R8G8B8A8_UNORM, [this, i](uint32_t mip) {
+                    loads[i][mip]++;
+                    uint32_t size = std::max(1u, TEXTURE_SIZE >> mip);
+                    return std::vector<uint8_t>(size * size * 4, static_cast<uint8_t>(i * 16 + mip));
+                } });
+            }
+
+            const uint32_t a = 0, b = 1, c = 2;
+
+            /// A and B at full size fit together
+            expect("A and B stream in", runUntil({ a, b }, [&] { return residentMip(a) == 0 && residentMip(b) == 0; }));
+
+            /// B is used again after A, so A is now the least recently used of the two
+            runFrames({ b }, 4);
+
+            /// C does not fit next to both, A goes first and B keeps every level
+            expect("C streams in", runUntil({ c }, [&] { return residentMip(c) == 0; }));
+            expect("A lost its finest level", residentMip(a) > 0);
+            expect("B kept every level", residentMip(b) == 0);
+
+            /// A comes back, now B was used longest ago and gives way
+            expect("A streams back in", runUntil({ a }, [&] { return residentMip(a) == 0; }));
+            expect("A level 0 was loaded again", loads[a][0] == 2);
+            expect("B lost its finest level", residentMip(b) > 0);
+            expect("C kept every level", residentMip(c) == 0);
+
+            expect("resident bytes stayed within the budget", !overBudget);
+
+            textureStreamingHandler.cleanupTextureStreaming(logicalDeviceHandler.device);
+            frameResourcesHandler.cleanupFrameResources(logicalDeviceHandler.device);
+
+            expect("every streamed image was destroyed", frameStats::liveObjects[static_cast<size_t>(frameStats::ObjectType::Image)] == 0);
+
+            logicalDeviceHandler.destroyLogicalDevice();
+            vkd.vkDestroyInstance(instance, nullptr);
+        }
+
+    private:
+
+        uint32_t residentMip(uint32_t texture) const {
+            return textureStreamingHandler.residentMip(ids[texture]);
+        }
+
+        /// One frame the way the renderer drives it, every texture in `used` drawn at full size
+        void frame(std::initializer_list<uint32_t> used) {
+
+            VkDevice device = logicalDeviceHandler.device;
+
+            frameResourcesHandler.beginFrame(device);
+
+            VkCommandBuffer commandBuffer = frameResourcesHandler.allocateCommandBuffer(device);
+
+            VkCommandBufferBeginInfo beginInfo{};
+            beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+            beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+            vkd.vkBeginCommandBuffer(commandBuffer, &beginInfo);
+
+            for (uint32_t texture : used) {
+                textureStreamingHandler.requestMip(ids[texture], static_cast<float>(TEXTURE_SIZE));
+            }
+
+            textureStreamingHandler.update(commandBuffer, frameResourcesHandler.currentFrame);
+
+            vkd.vkEndCommandBuffer(commandBuffer);
+
+            VkSubmitInfo submitInfo{};
+            submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+            submitInfo.commandBufferCount = 1;
+            submitInfo.pCommandBuffers = &commandBuffer;
+
+            frameResourcesHandler.submit(device, logicalDeviceHandler.graphicsQueue, submitInfo);
+            frameResourcesHandler.endFrame();
+
+            if (textureStreamingHandler.residentBytesTotal() > textureStreamingHandler.budgetBytes()) {
+                overBudget = true;
+            }
+
+            /// Gives the streaming thread time to read the requested levels
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+
+        void runFrames(std::initializer_list<uint32_t> used, uint32_t count) {
+            for (uint32_t i = 0; i < count; i++) {
+                frame(used);
+            }
+        }
+
+        template <typename Done>
+        bool runUntil(std::initializer_list<uint32_t> used, Done done) {
+
+            for (uint32_t i = 0; i < MAX_FRAMES; i++) {
+                frame(used);
+
+                if (done()) {
+                    return true;
+                }
+            }
+
+            return false;
+        }
+    };
+
+}
+
+int main() {
+
+    StreamingScene scene;
+
+    try {
+        scene.run();
+    } catch (const std::exception& e) {
+        printf("FAIL %s\n", e.what());
+        return 1;
+    }
+
+    if (failures != 0) {
+        printf("%d checks failed\n", failures);
+        return 1;
+    }
+
+    printf("All checks passed\n");
+    return 0;
+}